@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+
+namespace recap::app::broadcast_queue {
+
+/**
+ * A std::pmr::memory_resource serving allocations from a fixed buffer, for
+ * running a pmr::BroadcastQueue without calling the global operator new.
+ *
+ *   ArenaResource arena(1 << 20);
+ *   pmr::BroadcastQueue<Event> queue(&arena);
+ *
+ * Blocks are carved from the buffer by a std::pmr::monotonic_buffer_resource
+ * and recycled by a std::pmr::unsynchronized_pool_resource, so the chunks a
+ * std::deque frees as it shrinks are reused as it grows again. Once the
+ * buffer is used up, allocations go to upstream, which by default throws
+ * std::bad_alloc.
+ *
+ * NOT THREAD SAFE.
+ */
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    // Uses the caller's buffer, which must outlive the resource
+    explicit ArenaResource(
+        std::span<std::byte> buffer,
+        std::pmr::memory_resource *upstream = std::pmr::null_memory_resource()
+    ) :
+        arena(buffer.data(), buffer.size(), upstream), pool(&arena)
+    {}
+
+    // Allocates a buffer of size bytes, once
+    explicit ArenaResource(
+        std::size_t size, std::pmr::memory_resource *upstream = std::pmr::null_memory_resource()
+    ) :
+        owned(std::make_unique<std::byte[]>(size)),
+        arena(owned.get(), size, upstream),
+        pool(&arena)
+    {}
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Returns all memory to the arena. Everything allocated from the resource
+    // must have been destroyed.
+    void release()
+    {
+        pool.release();
+        arena.release();
+    }
+
+private:
+    std::unique_ptr<std::byte[]> owned;
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::unsynchronized_pool_resource pool;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        return pool.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        pool.deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+}; // namespace recap::app::broadcast_queue
@@ -0,0 +1,247 @@
+#include "../observable/allocation-counter.hpp"
+#include "arena-resource.hpp"
+#include "broadcast-queue.hpp"
+#include "concurrent-broadcast-queue.hpp"
+#include "shared-broadcast-queue.hpp"
+#include "spsc-broadcast-queue.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace recap::app::broadcast_queue;
+
+namespace {
+
+// Items pushed between each drain of the subscribers
+constexpr std::size_t batch_size = 64;
+
+template <std::size_t N> struct Payload {
+    std::array<char, N> bytes{};
+};
+
+template <class Queue> Queue make_queue()
+{
+    if constexpr (std::is_default_constructible_v<Queue>) {
+        return Queue();
+    } else if constexpr (std::is_same_v<Queue, SpscBroadcastQueue<typename Queue::value_type>>) {
+        return Queue(batch_size);
+    } else {
+        return Queue(batch_size, 1024);
+    }
+}
+
+template <class Queue> struct Holder {
+    typename Queue::subscriber_type subscriber;
+};
+
+template <class Queue> using Subscribers = std::vector<std::unique_ptr<Holder<Queue>>>;
+
+template <class Queue> Subscribers<Queue> subscribe_n(Queue& queue, std::int64_t n)
+{
+    Subscribers<Queue> subscribers;
+    for (std::int64_t i = 0; i < n; ++i) {
+        subscribers.emplace_back(new Holder<Queue>{queue.subscribe()});
+    }
+    return subscribers;
+}
+
+template <class Queue> void drain(Subscribers<Queue>& subscribers)
+{
+    for (auto& holder : subscribers) {
+        benchmark::DoNotOptimize(holder->subscriber.front());
+        holder->subscriber.pop_n(holder->subscriber.size());
+    }
+}
+
+void set_allocations_per_item(benchmark::State& state, std::size_t allocated)
+{
+    state.counters["allocs/item"] =
+        static_cast<double>(allocated) / static_cast<double>(state.iterations() * batch_size);
+}
+
+// Pushes a batch of items, then has every subscriber consume them
+template <class Queue, class Item> void BM_PushDrain(benchmark::State& state)
+{
+    Queue queue = make_queue<Queue>();
+    auto subscribers = subscribe_n(queue, state.range(0));
+    const Item item{};
+
+    const std::size_t before = allocations;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            queue.push(item);
+        }
+        drain(subscribers);
+    }
+    set_allocations_per_item(state, allocations - before);
+    state.SetItemsProcessed(state.iterations() * batch_size);
+    state.SetBytesProcessed(state.iterations() * batch_size * sizeof(Item));
+}
+
+// BM_PushDrain for a pmr::BroadcastQueue allocating from an ArenaResource
+template <class Item> void BM_PushDrainArena(benchmark::State& state)
+{
+    ArenaResource arena(64 << 20);
+    pmr::BroadcastQueue<Item> queue(&arena);
+    auto subscribers = subscribe_n(queue, state.range(0));
+    const Item item{};
+
+    const std::size_t before = allocations;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            queue.push(item);
+        }
+        drain(subscribers);
+    }
+    set_allocations_per_item(state, allocations - before);
+    state.SetItemsProcessed(state.iterations() * batch_size);
+    state.SetBytesProcessed(state.iterations() * batch_size * sizeof(Item));
+}
+
+// Times each push individually and reports percentiles of the push latency
+// in nanoseconds. The clock reads add a roughly constant overhead.
+template <class Queue, class Item> void BM_PushLatency(benchmark::State& state)
+{
+    using clock = std::chrono::steady_clock;
+
+    Queue queue = make_queue<Queue>();
+    auto subscribers = subscribe_n(queue, state.range(0));
+    const Item item{};
+
+    std::vector<std::int64_t> samples;
+    samples.reserve(1 << 20);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            const auto start = clock::now();
+            queue.push(item);
+            const auto end = clock::now();
+            if (samples.size() < samples.capacity()) {
+                samples.push_back(std::chrono::nanoseconds(end - start).count());
+            }
+        }
+        drain(subscribers);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    constexpr std::pair<const char *, double> percentiles[] = {
+        {"p50", 0.5}, {"p99", 0.99}, {"p999", 0.999}
+    };
+    for (const auto& [name, fraction] : percentiles) {
+        const auto index = static_cast<std::size_t>(fraction * (samples.size() - 1));
+        state.counters[name] = static_cast<double>(samples[index]);
+    }
+    state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+// Round trip of one item to another thread and back, through a pair of
+// single-subscriber queues. Both threads spin on their queue, so this needs
+// two free cores to be meaningful.
+template <class Queue> void BM_PingPong(benchmark::State& state)
+{
+    Queue request = make_queue<Queue>();
+    Queue response = make_queue<Queue>();
+    auto requests = request.subscribe();
+    auto responses = response.subscribe();
+
+    std::thread echo([&] {
+        for (;;) {
+            while (requests.empty()) {
+            }
+            const int value = requests.front();
+            requests.pop();
+            if (value < 0)
+                return;
+            response.push(value);
+        }
+    });
+
+    int value = 0;
+    for (auto _ : state) {
+        request.push(value++);
+        while (responses.empty()) {
+        }
+        benchmark::DoNotOptimize(responses.front());
+        responses.pop();
+    }
+    request.push(-1);
+    echo.join();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// One producer thread streaming to one subscriber on another thread
+template <class Queue> void BM_CrossThreadThroughput(benchmark::State& state)
+{
+    constexpr int items_per_iteration = 4096;
+
+    Queue queue = make_queue<Queue>();
+    auto subscriber = queue.subscribe();
+
+    for (auto _ : state) {
+        std::thread producer([&] {
+            for (int i = 0; i < items_per_iteration; ++i)
+                queue.push(i);
+        });
+        for (int received = 0; received < items_per_iteration;) {
+            const auto size = subscriber.size();
+            if (size == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            benchmark::DoNotOptimize(subscriber.front());
+            subscriber.pop_n(size);
+            received += static_cast<int>(size);
+        }
+        producer.join();
+    }
+    state.SetItemsProcessed(state.iterations() * items_per_iteration);
+}
+
+void subscriber_counts(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->ArgName("subscribers")->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+}
+
+template <class Item> using DequeQueue = BroadcastQueue<Item, std::deque<Item>>;
+template <class Item> using ListQueue = BroadcastQueue<Item, std::list<Item>>;
+
+}; // namespace
+
+// Subscriber count scaling, small payload
+BENCHMARK(BM_PushDrain<DequeQueue<int>, int>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<ListQueue<int>, int>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<SharedBroadcastQueue<int>, int>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<ConcurrentBroadcastQueue<int>, int>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrainArena<int>)->Apply(subscriber_counts);
+
+// Payload size scaling
+BENCHMARK(BM_PushDrain<DequeQueue<Payload<64>>, Payload<64>>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<DequeQueue<Payload<1024>>, Payload<1024>>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<SharedBroadcastQueue<Payload<64>>, Payload<64>>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<SharedBroadcastQueue<Payload<1024>>, Payload<1024>>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<ConcurrentBroadcastQueue<Payload<64>>, Payload<64>>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushDrain<ConcurrentBroadcastQueue<Payload<1024>>, Payload<1024>>)->Apply(subscriber_counts);
+
+// Push latency percentiles
+BENCHMARK(BM_PushLatency<DequeQueue<int>, int>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushLatency<SharedBroadcastQueue<int>, int>)->Apply(subscriber_counts);
+BENCHMARK(BM_PushLatency<ConcurrentBroadcastQueue<int>, int>)->Apply(subscriber_counts);
+
+// Single subscriber fast path against the general queues
+BENCHMARK(BM_PushDrain<SpscBroadcastQueue<int>, int>)->ArgName("subscribers")->Arg(1);
+BENCHMARK(BM_PushLatency<SpscBroadcastQueue<int>, int>)->ArgName("subscribers")->Arg(1);
+BENCHMARK(BM_PingPong<SpscBroadcastQueue<int>>)->UseRealTime();
+BENCHMARK(BM_PingPong<ConcurrentBroadcastQueue<int>>)->UseRealTime();
+BENCHMARK(BM_CrossThreadThroughput<SpscBroadcastQueue<int>>)->UseRealTime();
+BENCHMARK(BM_CrossThreadThroughput<ConcurrentBroadcastQueue<int>>)->UseRealTime();
@@ -0,0 +1,511 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace recap::app::broadcast_queue {
+
+template <class T> class BoundedBroadcastQueueSubscriber;
+
+/**
+ * What a BoundedBroadcastQueue does when pushing to a subscriber whose queue
+ * is already full.
+ */
+enum class OverflowPolicy {
+    Block,      // push() waits until the subscriber pops an item
+    DropOldest, // the item at the front of the subscriber's queue is dropped
+    DropNewest, // the pushed item is dropped for this subscriber
+    Disconnect, // the subscriber stops receiving items
+};
+
+namespace internal::bounded_broadcast_queue {
+
+// A fixed-capacity FIFO ring, allocated once up front
+template <class T> class Ring {
+public:
+    using size_type = std::size_t;
+
+    explicit Ring(size_type capacity) :
+        items(std::allocator<T>().allocate(capacity)), ring_capacity(capacity)
+    {}
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    ~Ring()
+    {
+        clear();
+        std::allocator<T>().deallocate(items, ring_capacity);
+    }
+
+    bool empty() const { return count == 0; }
+
+    bool full() const { return count == ring_capacity; }
+
+    size_type size() const { return count; }
+
+    size_type capacity() const { return ring_capacity; }
+
+    T& front() { return items[first]; }
+
+    T& back() { return items[index(count - 1)]; }
+
+    template <class... Args> void emplace_back(Args&&...args)
+    {
+        assert(!full());
+        std::construct_at(&items[index(count)], std::forward<Args>(args)...);
+        ++count;
+    }
+
+    void pop_front()
+    {
+        assert(!empty());
+        std::destroy_at(&items[first]);
+        first = index(1);
+        --count;
+    }
+
+    void clear()
+    {
+        while (!empty())
+            pop_front();
+    }
+
+private:
+    T *items;
+    size_type ring_capacity;
+    size_type first = 0;
+    size_type count = 0;
+
+    size_type index(size_type offset) const { return (first + offset) % ring_capacity; }
+};
+
+}; // namespace internal::bounded_broadcast_queue
+
+/**
+ * A thread-safe BroadcastQueue in which each subscriber queues at most
+ * `capacity` items. Memory use is fixed when subscribing, regardless of how
+ * slowly a subscriber consumes. What happens when a subscriber's queue is
+ * full is chosen per subscriber with an OverflowPolicy:
+ *
+ *   BoundedBroadcastQueue<int> queue(128);
+ *   auto control = queue.subscribe(OverflowPolicy::Block);
+ *   auto telemetry = queue.subscribe(OverflowPolicy::DropOldest);
+ *   queue.push(10);
+ *   telemetry.dropped()  // number of items telemetry has missed
+ *
+ * All members may be called from any thread, but each subscriber should only
+ * be consumed from one thread at a time. Subscribers can block until an item
+ * arrives with wait()/wait_for(), co_await next() from a coroutine, or poll a
+ * file descriptor from ready_fd(); a push only wakes subscribers that are
+ * waiting.
+ */
+template <class T> class BoundedBroadcastQueue {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using subscriber_type = BoundedBroadcastQueueSubscriber<T>;
+
+    explicit BoundedBroadcastQueue(size_type capacity) : queue_capacity(capacity)
+    {
+        assert(capacity > 0);
+    }
+
+    BoundedBroadcastQueue(const BoundedBroadcastQueue&) = delete;
+    BoundedBroadcastQueue& operator=(const BoundedBroadcastQueue&) = delete;
+    BoundedBroadcastQueue(BoundedBroadcastQueue&&) = delete;
+    BoundedBroadcastQueue& operator=(BoundedBroadcastQueue&&) = delete;
+
+    subscriber_type subscribe(OverflowPolicy policy = OverflowPolicy::Block)
+    {
+        std::lock_guard lock(mutex);
+        return subscriber_type(
+            *this, subscriptions.emplace(subscriptions.end(), queue_capacity, policy)
+        );
+    }
+
+    void clear()
+    {
+        std::lock_guard lock(mutex);
+        for (auto& subscription : subscriptions) {
+            subscription.items.clear();
+            subscription.clear_ready_fd();
+        }
+        not_full.notify_all();
+    }
+
+    // Blocks while any subscriber with OverflowPolicy::Block is full.
+    // Coroutines waiting on a subscriber's next() are resumed on this thread
+    // before push() returns.
+    void push(const value_type& value) { emplace(value); }
+
+    void push(value_type&& value) { emplace(std::move(value)); }
+
+    // Constructs the item in the last receiving subscriber's queue and copies
+    // it to the others, so an rvalue is moved rather than copied into one of
+    // the queues.
+    template <class... Args> void emplace(Args&&...args)
+    {
+        resume_list_t to_resume;
+        {
+            std::unique_lock lock(mutex);
+            not_full.wait(lock, [this] { return !blocked(); });
+            deliver(to_resume, std::forward<Args>(args)...);
+        }
+        resume(to_resume);
+    }
+
+    // Returns false without pushing if any subscriber with
+    // OverflowPolicy::Block is full
+    bool try_push(const value_type& value) { return try_emplace(value); }
+
+    bool try_push(value_type&& value) { return try_emplace(std::move(value)); }
+
+    template <class... Args> bool try_emplace(Args&&...args)
+    {
+        resume_list_t to_resume;
+        {
+            std::lock_guard lock(mutex);
+            if (blocked())
+                return false;
+            deliver(to_resume, std::forward<Args>(args)...);
+        }
+        resume(to_resume);
+        return true;
+    }
+
+    size_type num_subscribers() const
+    {
+        std::lock_guard lock(mutex);
+        return subscriptions.size();
+    }
+
+    size_type capacity() const { return queue_capacity; }
+
+private:
+    friend subscriber_type;
+
+    struct Subscription {
+        internal::bounded_broadcast_queue::Ring<T> items;
+        OverflowPolicy policy;
+        size_type dropped = 0;
+        bool disconnected = false;
+
+        // Waiting consumers; only signalled when there is one
+        unsigned waiting = 0;
+        std::condition_variable ready;
+        std::coroutine_handle<> awaiting;
+        int ready_fd = -1;
+
+        Subscription(size_type capacity, OverflowPolicy policy) :
+            items(capacity), policy(policy)
+        {}
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+
+        ~Subscription()
+        {
+#ifdef __linux__
+            if (ready_fd >= 0)
+                ::close(ready_fd);
+#endif
+        }
+
+        bool readable() const { return !items.empty() || disconnected; }
+
+        // The eventfd counter is non-zero exactly while the subscription is
+        // readable, so it only needs a syscall when that changes.
+        void set_ready_fd()
+        {
+#ifdef __linux__
+            if (ready_fd >= 0) {
+                std::uint64_t one = 1;
+                [[maybe_unused]] auto ret = ::write(ready_fd, &one, sizeof(one));
+            }
+#endif
+        }
+
+        void clear_ready_fd()
+        {
+#ifdef __linux__
+            if (ready_fd >= 0 && !readable()) {
+                std::uint64_t count;
+                [[maybe_unused]] auto ret = ::read(ready_fd, &count, sizeof(count));
+            }
+#endif
+        }
+    };
+
+    using subscription_list_t = std::list<Subscription>;
+    using resume_list_t = std::vector<std::coroutine_handle<>>;
+    using handle_t = typename subscription_list_t::iterator;
+
+    const size_type queue_capacity;
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    subscription_list_t subscriptions;
+
+    bool blocked() const
+    {
+        for (const auto& subscription : subscriptions) {
+            if (subscription.policy == OverflowPolicy::Block && subscription.items.full())
+                return true;
+        }
+        return false;
+    }
+
+    static void resume(const resume_list_t& to_resume)
+    {
+        for (auto handle : to_resume)
+            handle.resume();
+    }
+
+    // Called when a subscription becomes readable
+    static void wake(Subscription& subscription, resume_list_t& to_resume)
+    {
+        subscription.set_ready_fd();
+        if (subscription.waiting > 0)
+            subscription.ready.notify_one();
+        if (subscription.awaiting)
+            to_resume.push_back(std::exchange(subscription.awaiting, nullptr));
+    }
+
+    // Subscriptions are visited last first, so that the item is constructed
+    // in the last receiving one and copied from there into the others
+    template <class... Args> void deliver(resume_list_t& to_resume, Args&&...args)
+    {
+        const value_type *item = nullptr;
+        for (auto it = subscriptions.rbegin(); it != subscriptions.rend(); ++it) {
+            Subscription& subscription = *it;
+            if (subscription.disconnected)
+                continue;
+
+            const bool was_empty = subscription.items.empty();
+
+            if (subscription.items.full()) {
+                switch (subscription.policy) {
+                case OverflowPolicy::Block:
+                    assert(false);
+                    break;
+                case OverflowPolicy::DropOldest:
+                    subscription.items.pop_front();
+                    ++subscription.dropped;
+                    break;
+                case OverflowPolicy::DropNewest:
+                    ++subscription.dropped;
+                    continue;
+                case OverflowPolicy::Disconnect:
+                    ++subscription.dropped;
+                    subscription.disconnected = true;
+                    continue;
+                }
+            }
+
+            if (item) {
+                subscription.items.emplace_back(*item);
+            } else {
+                subscription.items.emplace_back(std::forward<Args>(args)...);
+                item = &subscription.items.back();
+            }
+            if (was_empty)
+                wake(subscription, to_resume);
+        }
+    }
+
+    void pop(Subscription& subscription)
+    {
+        bool was_full = subscription.items.full();
+        subscription.items.pop_front();
+        subscription.clear_ready_fd();
+        if (was_full && subscription.policy == OverflowPolicy::Block)
+            not_full.notify_all();
+    }
+
+    void unsubscribe(handle_t handle)
+    {
+        std::lock_guard lock(mutex);
+        subscriptions.erase(handle);
+        not_full.notify_all();
+    }
+};
+
+/**
+ * A reader of a BoundedBroadcastQueue. Since a push may drop the item at the
+ * front of the queue, elements are returned by value rather than reference.
+ */
+template <class T> class BoundedBroadcastQueueSubscriber {
+public:
+    using queue_type = BoundedBroadcastQueue<T>;
+    using value_type = typename queue_type::value_type;
+    using size_type = typename queue_type::size_type;
+
+    BoundedBroadcastQueueSubscriber(const BoundedBroadcastQueueSubscriber&) = delete;
+    BoundedBroadcastQueueSubscriber& operator=(const BoundedBroadcastQueueSubscriber&) = delete;
+    BoundedBroadcastQueueSubscriber(BoundedBroadcastQueueSubscriber&&) = delete;
+    BoundedBroadcastQueueSubscriber& operator=(BoundedBroadcastQueueSubscriber&&) = delete;
+
+    ~BoundedBroadcastQueueSubscriber() { controller.unsubscribe(handle); }
+
+    bool empty() const
+    {
+        std::lock_guard lock(controller.mutex);
+        return handle->items.empty();
+    }
+
+    size_type size() const
+    {
+        std::lock_guard lock(controller.mutex);
+        return handle->items.size();
+    }
+
+    // Must not be called when empty()
+    value_type front() const
+    {
+        std::lock_guard lock(controller.mutex);
+        return handle->items.front();
+    }
+
+    // Must not be called when empty()
+    void pop()
+    {
+        std::lock_guard lock(controller.mutex);
+        controller.pop(*handle);
+    }
+
+    bool try_pop(value_type& value)
+    {
+        std::lock_guard lock(controller.mutex);
+        if (handle->items.empty())
+            return false;
+        value = std::move(handle->items.front());
+        controller.pop(*handle);
+        return true;
+    }
+
+    // Blocks until an item is available or the subscriber is disconnected
+    void wait()
+    {
+        std::unique_lock lock(controller.mutex);
+        ++handle->waiting;
+        handle->ready.wait(lock, [this] { return handle->readable(); });
+        --handle->waiting;
+    }
+
+    // Returns false if no item became available within timeout
+    template <class Rep, class Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        std::unique_lock lock(controller.mutex);
+        ++handle->waiting;
+        bool readable = handle->ready.wait_for(lock, timeout, [this] {
+            return handle->readable();
+        });
+        --handle->waiting;
+        return readable && !handle->items.empty();
+    }
+
+#ifdef __linux__
+    // Returns an eventfd that is readable (e.g. for poll or epoll) whenever the
+    // subscriber has items or is disconnected. It is created on first call and
+    // owned by the subscriber; do not read from or close it.
+    int ready_fd()
+    {
+        std::lock_guard lock(controller.mutex);
+        if (handle->ready_fd < 0) {
+            handle->ready_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (handle->readable())
+                handle->set_ready_fd();
+        }
+        return handle->ready_fd;
+    }
+#endif // __linux__
+
+    /**
+     * Awaitable returned by next(). Resumes with the next item, which is
+     * popped, or std::nullopt if the subscriber has been disconnected and has
+     * no more items. If no item is queued the coroutine is suspended and
+     * resumed by the thread that pushes the next item.
+     */
+    class NextAwaitable {
+    public:
+        bool await_ready() const { return false; }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            std::lock_guard lock(subscriber.controller.mutex);
+            if (subscriber.handle->readable())
+                return false;
+            subscriber.handle->awaiting = coroutine;
+            return true;
+        }
+
+        std::optional<value_type> await_resume()
+        {
+            std::lock_guard lock(subscriber.controller.mutex);
+            auto& subscription = *subscriber.handle;
+            if (subscription.items.empty())
+                return std::nullopt;
+            std::optional<value_type> value(std::move(subscription.items.front()));
+            subscriber.controller.pop(subscription);
+            return value;
+        }
+
+    private:
+        friend BoundedBroadcastQueueSubscriber;
+
+        BoundedBroadcastQueueSubscriber& subscriber;
+
+        explicit NextAwaitable(BoundedBroadcastQueueSubscriber& subscriber) :
+            subscriber(subscriber)
+        {}
+    };
+
+    // co_await sub.next() to wait for and pop the next item. The subscriber
+    // must not be destroyed while a coroutine is suspended on it.
+    NextAwaitable next() { return NextAwaitable(*this); }
+
+    OverflowPolicy policy() const { return handle->policy; }
+
+    // Number of items this subscriber has missed because its queue was full
+    size_type dropped() const
+    {
+        std::lock_guard lock(controller.mutex);
+        return handle->dropped;
+    }
+
+    // True once an OverflowPolicy::Disconnect subscriber has overflowed. Items
+    // queued before the overflow can still be popped.
+    bool disconnected() const
+    {
+        std::lock_guard lock(controller.mutex);
+        return handle->disconnected;
+    }
+
+private:
+    friend queue_type;
+
+    queue_type& controller;
+    typename queue_type::handle_t handle;
+
+    BoundedBroadcastQueueSubscriber(queue_type& controller, typename queue_type::handle_t handle) :
+        controller(controller), handle(handle)
+    {}
+};
+
+}; // namespace recap::app::broadcast_queue
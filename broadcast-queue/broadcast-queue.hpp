@@ -1,14 +1,143 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdio>
 #include <deque>
+#include <functional>
 #include <list>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace recap::app::broadcast_queue {
 
-template <class T, class Container> class BroadcastQueueSubscriber;
+/**
+ * Use BroadcastQueue<SharedPayload<T>> to store each pushed item once, shared
+ * between subscribers through a std::shared_ptr<const T>, instead of copying
+ * it into every subscriber's queue. Subscribers get const access to the T.
+ * Worthwhile for large items that are expensive to copy.
+ */
+template <class T> struct SharedPayload {};
+
+/**
+ * Metrics policies for BroadcastQueue. With the default, NoMetrics, the
+ * counters are compiled out and cost nothing; BroadcastQueue<T, Container,
+ * WithMetrics> keeps them for each subscriber. Queues with and without
+ * metrics are different types, so they can be mixed freely.
+ */
+struct NoMetrics {};
+struct WithMetrics {};
+
+/**
+ * A snapshot of one subscriber's counters, from BroadcastQueueSubscriber::
+ * metrics(), for queues with WithMetrics.
+ */
+struct BroadcastQueueMetrics {
+    using clock = std::chrono::steady_clock;
+
+    std::size_t pushed = 0;    // items queued for the subscriber
+    std::size_t popped = 0;    // items popped by the subscriber
+    std::size_t depth = 0;     // items queued and not yet popped
+    std::size_t max_depth = 0; // highest depth since subscribing
+    clock::duration lag{};     // time since the oldest queued item was pushed
+    std::optional<clock::time_point> last_pop;
+};
+
+namespace internal::broadcast_queue {
+
+// Allocator is the queue's, used for the push times so that they come from
+// the same place as the items they describe
+template <class Metrics, class Allocator> class SubscriptionMetrics;
+
+template <class Allocator> class SubscriptionMetrics<WithMetrics, Allocator> {
+public:
+    using clock = BroadcastQueueMetrics::clock;
+    using time_point = clock::time_point;
+
+    explicit SubscriptionMetrics(const Allocator& allocator) : push_times(allocator) {}
+
+    static time_point now() { return clock::now(); }
+
+    void pushed(time_point time)
+    {
+        ++num_pushed;
+        push_times.push_back(time);
+        max_depth = std::max(max_depth, push_times.size());
+    }
+
+    void popped(std::size_t n, time_point time)
+    {
+        num_popped += n;
+        push_times.erase(push_times.begin(), push_times.begin() + n);
+        last_pop = time;
+    }
+
+    void cleared() { push_times.clear(); }
+
+    BroadcastQueueMetrics snapshot(time_point time) const
+    {
+        return {
+            .pushed = num_pushed,
+            .popped = num_popped,
+            .depth = push_times.size(),
+            .max_depth = max_depth,
+            .lag = push_times.empty() ? clock::duration() : time - push_times.front(),
+            .last_pop = last_pop,
+        };
+    }
+
+private:
+    std::size_t num_pushed = 0;
+    std::size_t num_popped = 0;
+    std::size_t max_depth = 0;
+    // of the queued items
+    std::deque<time_point, typename std::allocator_traits<Allocator>::template rebind_alloc<time_point>>
+        push_times;
+    std::optional<time_point> last_pop;
+};
+
+// Does nothing, and is optimised away
+template <class Allocator> class SubscriptionMetrics<NoMetrics, Allocator> {
+public:
+    struct time_point {};
+
+    explicit SubscriptionMetrics(const Allocator&) {}
+
+    static time_point now() { return {}; }
+
+    void pushed(time_point) {}
+
+    void popped(std::size_t, time_point) {}
+
+    void cleared() {}
+};
+
+template <class T> struct payload_traits {
+    using value_type = T;
+    using stored_type = T;
+    static constexpr bool shared = false;
+
+    static T& get(T& item) { return item; }
+    static const T& get(const T& item) { return item; }
+};
+
+template <class T> struct payload_traits<SharedPayload<T>> {
+    using value_type = T;
+    using stored_type = std::shared_ptr<const T>;
+    static constexpr bool shared = true;
+
+    static const T& get(const stored_type& item) { return *item; }
+};
+
+}; // namespace internal::broadcast_queue
+
+template <class T, class Container, class Metrics> class BroadcastQueueSubscriber;
 
 /**
  * A simple queue container for queuing items to multiple consumers.
@@ -21,63 +150,193 @@ template <class T, class Container> class BroadcastQueueSubscriber;
  *   sub1.pop();
  *   sub2.front() // returns 10
  *
+ * The subscriber list, the subscribers' queues and, in SharedPayload mode, the
+ * shared payloads are all allocated with the Container's allocator. See
+ * pmr::BroadcastQueue and ArenaResource to run a queue in a preallocated
+ * arena.
+ *
  * NOT THREAD SAFE.
  */
-template <class T, class Container = std::deque<T>> class BroadcastQueue {
+template <
+    class T,
+    class Container = std::deque<typename internal::broadcast_queue::payload_traits<T>::stored_type>,
+    class Metrics = NoMetrics>
+class BroadcastQueue {
+    using traits = internal::broadcast_queue::payload_traits<T>;
+
 public:
+    using value_type = typename traits::value_type;
+    using stored_type = typename traits::stored_type;
     using container_type = Container;
-    using queue_type = std::queue<T, container_type>;
+    using allocator_type = typename container_type::allocator_type;
+    using queue_type = std::queue<stored_type, container_type>;
     using size_type = typename queue_type::size_type;
-    using subscriber_type = BroadcastQueueSubscriber<T, Container>;
+    using subscriber_type = BroadcastQueueSubscriber<T, Container, Metrics>;
+    using filter_type = std::function<bool(const value_type&)>;
+
+    static constexpr bool metrics_enabled = std::is_same_v<Metrics, WithMetrics>;
+
+    BroadcastQueue() = default;
+
+    explicit BroadcastQueue(const allocator_type& allocator) :
+        allocator(allocator), observers(allocator)
+    {}
 
-    subscriber_type subscribe()
+    BroadcastQueue(const BroadcastQueue&) = delete;
+    BroadcastQueue& operator=(const BroadcastQueue&) = delete;
+    BroadcastQueue(BroadcastQueue&&) = delete;
+    BroadcastQueue& operator=(BroadcastQueue&&) = delete;
+
+    allocator_type get_allocator() const { return allocator; }
+
+    subscriber_type subscribe() { return subscribe(filter_type()); }
+
+    // Only items for which filter returns true are queued for the subscriber.
+    // The filter is called once per pushed item. To route items by key
+    // without calling a filter per subscriber, see TopicBroadcastQueue.
+    subscriber_type subscribe(filter_type filter)
     {
+        if (filter)
+            ++num_filtered;
         return subscriber_type(
-            *this, observers.emplace(observers.end(), std::make_unique<queue_type>())
+            *this,
+            observers.emplace(observers.end(), queue_type(allocator), std::move(filter), allocator)
         );
     }
 
     void clear()
     {
-        for (const auto& queue : observers)
-            queue_type().swap(*queue);
+        for (auto& observer : observers) {
+            queue_type(allocator).swap(observer.queue);
+            observer.metrics.cleared();
+        }
     }
 
-    void push(const typename queue_type::value_type& value)
+    void push(const value_type& value) { emplace(value); }
+
+    void push(value_type&& value) { emplace(std::move(value)); }
+
+    // Shares an existing payload with the subscribers, in SharedPayload mode
+    void push(stored_type item)
+    requires traits::shared
     {
-        for (const auto& queue : observers)
-            queue->push(value);
+        distribute(std::move(item));
     }
 
-    void push(typename queue_type::value_type&& value)
+    // Constructs the item in the last subscriber's queue and copies it to the
+    // others, so an rvalue is moved rather than copied into one of the queues.
+    // In SharedPayload mode the item is constructed once and shared.
+    template <class... Args> void emplace(Args&&...args)
     {
-        for (const auto& queue : observers)
-            queue->push(value);
+        if (observers.empty())
+            return;
+
+        if constexpr (traits::shared) {
+            distribute(std::allocate_shared<const value_type>(allocator, std::forward<Args>(args)...));
+        } else if (num_filtered != 0) {
+            // The filters need the item before it can be placed
+            distribute(value_type(std::forward<Args>(args)...));
+        } else {
+            const auto now = metrics_type::now();
+            Subscription& last = observers.back();
+            last.queue.emplace(std::forward<Args>(args)...);
+            last.metrics.pushed(now);
+            const stored_type& item = last.queue.back();
+            for (auto it = observers.begin(); &*it != &last; ++it) {
+                it->queue.push(item);
+                it->metrics.pushed(now);
+            }
+        }
     }
 
     size_type num_subscribers() const { return observers.size(); }
 
+    // The metrics of every subscriber, in the order they subscribed.
+    // Requires WithMetrics.
+    std::vector<BroadcastQueueMetrics> metrics() const
+    requires metrics_enabled
+    {
+        const auto now = metrics_type::now();
+        std::vector<BroadcastQueueMetrics> result;
+        result.reserve(observers.size());
+        for (const auto& observer : observers)
+            result.push_back(observer.metrics.snapshot(now));
+        return result;
+    }
+
 private:
     friend subscriber_type;
 
-    using observer_list_t = std::list<std::unique_ptr<queue_type>>;
+    using metrics_type = internal::broadcast_queue::SubscriptionMetrics<Metrics, allocator_type>;
+
+    struct Subscription {
+        Subscription(queue_type queue, filter_type filter, const allocator_type& allocator) :
+            queue(std::move(queue)), filter(std::move(filter)), metrics(allocator)
+        {}
+
+        queue_type queue;
+        filter_type filter;
+        [[no_unique_address]] metrics_type metrics;
+
+        bool accepts(const stored_type& item) const
+        {
+            return !filter || filter(traits::get(item));
+        }
+    };
+
+    using observer_list_t = std::list<
+        Subscription,
+        typename std::allocator_traits<allocator_type>::template rebind_alloc<Subscription>>;
     using handle_t = typename observer_list_t::iterator;
 
-    observer_list_t observers;
+    allocator_type allocator;
+    observer_list_t observers{allocator};
+    size_type num_filtered = 0;
+
+    void unsubscribe(handle_t handle)
+    {
+        if (handle->filter)
+            --num_filtered;
+        observers.erase(handle);
+    }
 
-    void unsubscribe(handle_t handle) { observers.erase(handle); }
+    // Copies item into every accepting queue except the last, which it is
+    // moved into
+    void distribute(stored_type&& item)
+    {
+        const auto now = metrics_type::now();
+        Subscription *target = nullptr;
+        for (auto& observer : observers) {
+            if (!observer.accepts(item))
+                continue;
+            if (target) {
+                target->queue.push(item);
+                target->metrics.pushed(now);
+            }
+            target = &observer;
+        }
+        if (target) {
+            target->queue.push(std::move(item));
+            target->metrics.pushed(now);
+        }
+    }
 };
 
 /**
- * Provides the same element access and capacity interfaces as std::queue<T>
+ * Provides the same element access and capacity interfaces as std::queue<T>.
+ * In SharedPayload mode, elements are only accessible through const
+ * references.
  */
-template <class T, class Container> class BroadcastQueueSubscriber {
+template <class T, class Container, class Metrics> class BroadcastQueueSubscriber {
+    using traits = internal::broadcast_queue::payload_traits<T>;
+
 public:
-    using queue_type = BroadcastQueue<T, Container>;
-    using value_type = typename queue_type::queue_type::value_type;
+    using queue_type = BroadcastQueue<T, Container, Metrics>;
+    using value_type = typename queue_type::value_type;
     using size_type = typename queue_type::queue_type::size_type;
-    using reference = typename queue_type::queue_type::reference;
-    using const_reference = typename queue_type::queue_type::const_reference;
+    using const_reference = const value_type&;
+    using reference =
+        std::conditional_t<traits::shared, const_reference, typename queue_type::queue_type::reference>;
 
     BroadcastQueueSubscriber(const BroadcastQueueSubscriber&) = delete;
     BroadcastQueueSubscriber& operator=(const BroadcastQueueSubscriber&) = delete;
@@ -86,19 +345,39 @@ public:
 
     ~BroadcastQueueSubscriber() { controller.unsubscribe(handle); }
 
-    bool empty() const { return (*handle)->empty(); }
+    bool empty() const { return handle->queue.empty(); }
+
+    const_reference back() const { return traits::get(handle->queue.back()); }
 
-    const_reference back() const { return (*handle)->back(); }
+    reference back() { return traits::get(handle->queue.back()); }
 
-    reference back() { return (*handle)->back(); }
+    const_reference front() const { return traits::get(handle->queue.front()); }
 
-    const_reference front() const { return (*handle)->front(); }
+    reference front() { return traits::get(handle->queue.front()); }
 
-    reference front() { return (*handle)->front(); }
+    void pop()
+    {
+        handle->queue.pop();
+        handle->metrics.popped(1, queue_type::metrics_type::now());
+    }
+
+    // Pops the first n items. n must not be greater than size(). The items
+    // are not contiguous in memory; see SharedBroadcastQueue for span access.
+    void pop_n(size_type n)
+    {
+        handle->metrics.popped(n, queue_type::metrics_type::now());
+        for (; n > 0; --n)
+            handle->queue.pop();
+    }
 
-    void pop() { (*handle)->pop(); }
+    size_type size() const { return handle->queue.size(); }
 
-    size_type size() const { return (*handle)->size(); }
+    // Requires WithMetrics
+    BroadcastQueueMetrics metrics() const
+    requires queue_type::metrics_enabled
+    {
+        return handle->metrics.snapshot(queue_type::metrics_type::now());
+    }
 
 private:
     friend queue_type;
@@ -111,4 +390,18 @@ private:
     {}
 };
 
+namespace pmr {
+
+// A BroadcastQueue allocating from a std::pmr::memory_resource, e.g.
+//
+//   ArenaResource arena(1 << 20);
+//   pmr::BroadcastQueue<int> queue(&arena);
+template <class T, class Metrics = NoMetrics>
+using BroadcastQueue = broadcast_queue::BroadcastQueue<
+    T,
+    std::pmr::deque<typename internal::broadcast_queue::payload_traits<T>::stored_type>,
+    Metrics>;
+
+}; // namespace pmr
+
 }; // namespace recap::app::broadcast_queue
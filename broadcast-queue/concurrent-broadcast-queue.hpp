@@ -0,0 +1,500 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace recap::app::broadcast_queue {
+
+template <class T> class ConcurrentBroadcastQueueSubscriber;
+template <class T> class ConcurrentBroadcastQueueGroup;
+template <class T> class ConcurrentBroadcastQueueWorker;
+
+/**
+ * A bounded, lock-free BroadcastQueue for multiple producers and multiple
+ * subscribers. Every item is stored once in a ring of `capacity` slots.
+ *
+ *   ConcurrentBroadcastQueue<int> queue(1024);
+ *   auto sub = queue.subscribe();
+ *
+ *   // Producer threads:
+ *   queue.push(10);
+ *
+ *   // Subscriber thread:
+ *   if (!sub.empty()) {
+ *       use(sub.front());
+ *       sub.pop();
+ *   }
+ *
+ * Producers claim a sequence number with an atomic compare-and-swap, write
+ * the item into its slot and then publish it by storing the sequence number
+ * in the slot. Each subscriber has its own cursor and consumes without
+ * taking a lock. A slot is not reused until every subscriber has moved past
+ * it, so a full queue makes push() wait for the slowest subscriber
+ * (try_push() returns false instead). If constructing an item throws, nothing
+ * is pushed; items whose construction may throw are constructed before their
+ * slot is claimed and then moved into it.
+ *
+ * A consumer group, from subscribe_group(), receives every item once like a
+ * subscriber, but shares the items between its workers: each item is taken
+ * by exactly one worker.
+ *
+ *   auto group = queue.subscribe_group();
+ *
+ *   // Worker threads:
+ *   auto worker = group.subscribe();
+ *   T item;
+ *   if (worker.try_pop(item))
+ *       use(item);
+ *
+ * The queue and subscribe()/unsubscribe are thread safe. A single subscriber
+ * or worker must only be used by one thread at a time. A group and its
+ * workers take one of the max_subscribers slots each.
+ */
+template <class T> class ConcurrentBroadcastQueue {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using sequence_type = std::uint64_t;
+    using subscriber_type = ConcurrentBroadcastQueueSubscriber<T>;
+    using group_type = ConcurrentBroadcastQueueGroup<T>;
+
+    static constexpr size_type default_max_subscribers = 64;
+
+    // capacity is rounded up to a power of two
+    explicit ConcurrentBroadcastQueue(
+        size_type capacity, size_type max_subscribers = default_max_subscribers
+    ) :
+        ring_capacity(round_up_pow2(capacity)),
+        published(std::make_unique<std::atomic<sequence_type>[]>(ring_capacity)),
+        values(std::allocator<T>().allocate(ring_capacity)),
+        max_subscribers(max_subscribers),
+        cursors(std::make_unique<Cursor[]>(max_subscribers))
+    {}
+
+    ConcurrentBroadcastQueue(const ConcurrentBroadcastQueue&) = delete;
+    ConcurrentBroadcastQueue& operator=(const ConcurrentBroadcastQueue&) = delete;
+    ConcurrentBroadcastQueue(ConcurrentBroadcastQueue&&) = delete;
+    ConcurrentBroadcastQueue& operator=(ConcurrentBroadcastQueue&&) = delete;
+
+    ~ConcurrentBroadcastQueue()
+    {
+        for (size_type i = 0; i < ring_capacity; ++i) {
+            if (published[i].load(std::memory_order_acquire) != 0)
+                std::destroy_at(&values[i]);
+        }
+        std::allocator<T>().deallocate(values, ring_capacity);
+    }
+
+    // Throws std::length_error if max_subscribers are already subscribed
+    subscriber_type subscribe()
+    {
+        Cursor& cursor = reserve_cursor(claimed.load());
+        num_active.fetch_add(1, std::memory_order_relaxed);
+        return subscriber_type(*this, cursor, start_cursor(cursor));
+    }
+
+    // Creates a consumer group, which counts as one subscriber. Throws
+    // std::length_error if max_subscribers are already subscribed.
+    group_type subscribe_group()
+    {
+        Cursor& cursor = reserve_cursor(claimed.load());
+        num_active.fetch_add(1, std::memory_order_relaxed);
+        start_cursor(cursor);
+        return group_type(*this, cursor);
+    }
+
+    // Returns false without pushing if the slowest subscriber is `capacity`
+    // items behind.
+    bool try_push(const value_type& value) { return try_emplace(value); }
+
+    bool try_push(value_type&& value) { return try_emplace(std::move(value)); }
+
+    template <class... Args> bool try_emplace(Args&&...args)
+    {
+        if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+            return try_emplace(construct(std::forward<Args>(args)...));
+        } else {
+            sequence_type seq;
+            if (!claim(seq))
+                return false;
+            publish(seq, std::forward<Args>(args)...);
+            return true;
+        }
+    }
+
+    // Waits for the slowest subscriber if the queue is full
+    void push(const value_type& value) { emplace(value); }
+
+    void push(value_type&& value) { emplace(std::move(value)); }
+
+    template <class... Args> void emplace(Args&&...args)
+    {
+        if constexpr (!std::is_nothrow_constructible_v<T, Args&&...>) {
+            emplace(construct(std::forward<Args>(args)...));
+        } else {
+            sequence_type seq;
+            while (!claim(seq))
+                std::this_thread::yield();
+            publish(seq, std::forward<Args>(args)...);
+        }
+    }
+
+    size_type num_subscribers() const { return num_active.load(std::memory_order_relaxed); }
+
+    size_type capacity() const { return ring_capacity; }
+
+private:
+    friend subscriber_type;
+    friend group_type;
+    friend ConcurrentBroadcastQueueWorker<T>;
+
+    static constexpr size_type cache_line_size = 64;
+
+    static constexpr sequence_type unused = ~sequence_type(0);
+
+    // A worker's cursor when it is not reading an item. Like `unused`, it
+    // never gates producers, but the cursor stays reserved.
+    static constexpr sequence_type idle = unused - 1;
+
+    // Sequence number of the next item a subscriber will read, or `unused`.
+    // For a group, the next item to be taken by one of its workers. For a
+    // worker, the item it is reading, or `idle`.
+    struct alignas(cache_line_size) Cursor {
+        std::atomic<sequence_type> next{unused};
+    };
+
+    // Ring storage. The item with sequence number s is stored at index
+    // (s & (ring_capacity - 1)). published[i] holds one more than the sequence
+    // number of the item in values[i], or zero if nothing has been written to
+    // it yet. Items are kept apart from their sequence numbers so that runs of
+    // published items are contiguous in memory.
+    const size_type ring_capacity;
+    const std::unique_ptr<std::atomic<sequence_type>[]> published;
+    T *const values;
+
+    const size_type max_subscribers;
+    const std::unique_ptr<Cursor[]> cursors;
+    std::atomic<size_type> num_active{0};
+
+    // Next sequence number to be claimed by a producer
+    alignas(cache_line_size) std::atomic<sequence_type> claimed{0};
+
+    // A lower bound on every subscriber cursor, refreshed when a producer runs
+    // into it. Saves scanning the cursors on every push.
+    alignas(cache_line_size) std::atomic<sequence_type> gate{0};
+
+    static size_type round_up_pow2(size_type n)
+    {
+        size_type result = 1;
+        while (result < n)
+            result <<= 1;
+        return result;
+    }
+
+    size_type index(sequence_type seq) const
+    {
+        return static_cast<size_type>(seq & (ring_capacity - 1));
+    }
+
+    bool is_published(sequence_type seq) const
+    {
+        return published[index(seq)].load(std::memory_order_acquire) == seq + 1;
+    }
+
+    // Throws std::length_error if every cursor is in use
+    Cursor& reserve_cursor(sequence_type next)
+    {
+        for (size_type i = 0; i < max_subscribers; ++i) {
+            sequence_type expected = unused;
+            if (cursors[i].next.compare_exchange_strong(expected, next))
+                return cursors[i];
+        }
+        throw std::length_error("ConcurrentBroadcastQueue: too many subscribers");
+    }
+
+    // A new cursor starts at the current claim position. Producers gate on the
+    // cursors they can see; re-reading `claimed` after storing the cursor
+    // guarantees any producer that claims past our start position has seen
+    // the cursor, so our first slot cannot be lapped.
+    sequence_type start_cursor(Cursor& cursor)
+    {
+        sequence_type start = cursor.next.load();
+        for (;;) {
+            sequence_type current = claimed.load();
+            if (current == start)
+                return start;
+            start = current;
+            cursor.next.store(start);
+        }
+    }
+
+    // The cursors are read one at a time, not as a snapshot, so a worker's
+    // cursor may be read as idle just before it takes an item from its group,
+    // and the group's cursor then read after it has moved past the item. The
+    // cursors are therefore scanned twice: a worker sets its cursor before
+    // moving the group's cursor, so if the first scan saw the group's cursor
+    // past an item the worker is still reading, the second scan sees the
+    // worker's cursor on it.
+    sequence_type min_cursor(sequence_type seq) const
+    {
+        sequence_type result = seq;
+        for (int scan = 0; scan < 2; ++scan) {
+            for (size_type i = 0; i < max_subscribers; ++i) {
+                sequence_type next = cursors[i].next.load();
+                if (next < result)
+                    result = next;
+            }
+        }
+        return result;
+    }
+
+    // A claimed sequence number must be published, so an item whose
+    // construction may throw is constructed before claiming one
+    template <class... Args> static T construct(Args&&...args)
+    {
+        static_assert(
+            std::is_nothrow_move_constructible_v<T>,
+            "ConcurrentBroadcastQueue: T must be nothrow move constructible if "
+            "constructing it may throw"
+        );
+        return T(std::forward<Args>(args)...);
+    }
+
+    bool claim(sequence_type& seq)
+    {
+        seq = claimed.load();
+        for (;;) {
+            if (seq >= gate.load() + ring_capacity) {
+                sequence_type min = min_cursor(seq);
+                gate.store(min);
+                if (seq >= min + ring_capacity)
+                    return false;
+            }
+            if (claimed.compare_exchange_weak(seq, seq + 1))
+                return true;
+        }
+    }
+
+    // Must not throw, as the slot's previous item is destroyed first
+    template <class... Args> void publish(sequence_type seq, Args&&...args) noexcept
+    {
+        const size_type i = index(seq);
+
+        // Every subscriber has moved past the previous item in this slot, but
+        // with no subscribers its producer may still be writing it.
+        const sequence_type previous = seq < ring_capacity ? 0 : seq - ring_capacity + 1;
+        while (published[i].load(std::memory_order_acquire) != previous)
+            std::this_thread::yield();
+
+        if (previous != 0)
+            std::destroy_at(&values[i]);
+        std::construct_at(&values[i], std::forward<Args>(args)...);
+        published[i].store(seq + 1, std::memory_order_release);
+    }
+
+    void unsubscribe(Cursor& cursor)
+    {
+        cursor.next.store(unused, std::memory_order_release);
+        num_active.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Takes the group's next item for a worker. The worker's cursor is set to
+    // the item before the group's cursor moves past it, so a producer that
+    // can no longer see the item through the group's cursor sees it through
+    // the worker's.
+    bool take(Cursor& group, Cursor& worker, value_type& value)
+    {
+        sequence_type seq = group.next.load();
+        for (;;) {
+            if (!is_published(seq)) {
+                // Empty, unless seq is stale and has since been overwritten
+                const sequence_type current = group.next.load();
+                if (current == seq) {
+                    worker.next.store(idle, std::memory_order_release);
+                    return false;
+                }
+                seq = current;
+                continue;
+            }
+            worker.next.store(seq);
+            if (group.next.compare_exchange_weak(seq, seq + 1))
+                break;
+        }
+        value = values[index(seq)];
+        worker.next.store(idle, std::memory_order_release);
+        return true;
+    }
+};
+
+/**
+ * A lock-free reader of a ConcurrentBroadcastQueue. Provides the element
+ * access and capacity interfaces of std::queue<T>, except that elements are
+ * only accessible through const references.
+ */
+template <class T> class ConcurrentBroadcastQueueSubscriber {
+public:
+    using queue_type = ConcurrentBroadcastQueue<T>;
+    using value_type = typename queue_type::value_type;
+    using size_type = typename queue_type::size_type;
+    using const_reference = const value_type&;
+
+    ConcurrentBroadcastQueueSubscriber(const ConcurrentBroadcastQueueSubscriber&) = delete;
+    ConcurrentBroadcastQueueSubscriber&
+    operator=(const ConcurrentBroadcastQueueSubscriber&) = delete;
+    ConcurrentBroadcastQueueSubscriber(ConcurrentBroadcastQueueSubscriber&&) = delete;
+    ConcurrentBroadcastQueueSubscriber& operator=(ConcurrentBroadcastQueueSubscriber&&) = delete;
+
+    ~ConcurrentBroadcastQueueSubscriber() { controller.unsubscribe(cursor); }
+
+    bool empty() const { return !controller.is_published(position); }
+
+    // Must not be called when empty()
+    const_reference front() const { return controller.values[controller.index(position)]; }
+
+    // Must not be called when empty()
+    void pop() { cursor.next.store(++position, std::memory_order_release); }
+
+    // Returns the longest run of published items, starting at front(), that is
+    // contiguous in memory. It is only empty if the subscriber is empty(); the
+    // items stay valid until they are popped.
+    std::span<const value_type> front_span() const
+    {
+        const size_type first = controller.index(position);
+        size_type count = 0;
+        while (first + count < controller.ring_capacity
+               && controller.is_published(position + count))
+            ++count;
+        return {&controller.values[first], count};
+    }
+
+    // Pops n items with a single cursor update. Must not pop more than are
+    // published, e.g. the size of front_span().
+    void pop_n(size_type n)
+    {
+        position += n;
+        cursor.next.store(position, std::memory_order_release);
+    }
+
+    bool try_pop(value_type& value)
+    {
+        if (empty())
+            return false;
+        value = front();
+        pop();
+        return true;
+    }
+
+    // Includes items that have been claimed by a producer but not yet
+    // published, so is only exact while no push is in progress.
+    size_type size() const
+    {
+        return static_cast<size_type>(controller.claimed.load() - position);
+    }
+
+private:
+    friend queue_type;
+
+    using sequence_type = typename queue_type::sequence_type;
+
+    queue_type& controller;
+    typename queue_type::Cursor& cursor;
+    sequence_type position;
+
+    ConcurrentBroadcastQueueSubscriber(
+        queue_type& controller, typename queue_type::Cursor& cursor, sequence_type position
+    ) :
+        controller(controller), cursor(cursor), position(position)
+    {}
+};
+
+/**
+ * A consumer group of a ConcurrentBroadcastQueue, which shares the items
+ * between its workers. It must outlive its workers.
+ */
+template <class T> class ConcurrentBroadcastQueueGroup {
+public:
+    using queue_type = ConcurrentBroadcastQueue<T>;
+    using size_type = typename queue_type::size_type;
+    using worker_type = ConcurrentBroadcastQueueWorker<T>;
+
+    ConcurrentBroadcastQueueGroup(const ConcurrentBroadcastQueueGroup&) = delete;
+    ConcurrentBroadcastQueueGroup& operator=(const ConcurrentBroadcastQueueGroup&) = delete;
+    ConcurrentBroadcastQueueGroup(ConcurrentBroadcastQueueGroup&&) = delete;
+    ConcurrentBroadcastQueueGroup& operator=(ConcurrentBroadcastQueueGroup&&) = delete;
+
+    ~ConcurrentBroadcastQueueGroup() { controller.unsubscribe(cursor); }
+
+    // Throws std::length_error if the queue's max_subscribers are in use
+    worker_type subscribe()
+    {
+        return worker_type(*this, controller.reserve_cursor(queue_type::idle));
+    }
+
+    // Items not yet taken by a worker. As for a subscriber, includes items
+    // that are claimed but not yet published.
+    size_type size() const
+    {
+        return static_cast<size_type>(controller.claimed.load() - cursor.next.load());
+    }
+
+    bool empty() const { return !controller.is_published(cursor.next.load()); }
+
+private:
+    friend queue_type;
+    friend worker_type;
+
+    queue_type& controller;
+    typename queue_type::Cursor& cursor;
+
+    ConcurrentBroadcastQueueGroup(queue_type& controller, typename queue_type::Cursor& cursor) :
+        controller(controller), cursor(cursor)
+    {}
+};
+
+/**
+ * A worker in a ConcurrentBroadcastQueueGroup, competing with the group's
+ * other workers for its items.
+ */
+template <class T> class ConcurrentBroadcastQueueWorker {
+public:
+    using group_type = ConcurrentBroadcastQueueGroup<T>;
+    using value_type = T;
+
+    ConcurrentBroadcastQueueWorker(const ConcurrentBroadcastQueueWorker&) = delete;
+    ConcurrentBroadcastQueueWorker& operator=(const ConcurrentBroadcastQueueWorker&) = delete;
+    ConcurrentBroadcastQueueWorker(ConcurrentBroadcastQueueWorker&&) = delete;
+    ConcurrentBroadcastQueueWorker& operator=(ConcurrentBroadcastQueueWorker&&) = delete;
+
+    ~ConcurrentBroadcastQueueWorker()
+    {
+        cursor.next.store(group_type::queue_type::unused, std::memory_order_release);
+    }
+
+    // Takes the group's next item, if there is one. Returns false if every
+    // published item has been taken.
+    bool try_pop(value_type& value)
+    {
+        return group.controller.take(group.cursor, cursor, value);
+    }
+
+private:
+    friend group_type;
+
+    group_type& group;
+    typename group_type::queue_type::Cursor& cursor;
+
+    ConcurrentBroadcastQueueWorker(
+        group_type& group, typename group_type::queue_type::Cursor& cursor
+    ) :
+        group(group), cursor(cursor)
+    {}
+};
+
+}; // namespace recap::app::broadcast_queue
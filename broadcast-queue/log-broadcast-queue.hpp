@@ -0,0 +1,446 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace recap::app::broadcast_queue {
+
+template <class T> class LogBroadcastQueueSubscriber;
+
+struct LogOptions {
+    // Size of each segment file. Rounded down to a whole number of items.
+    std::size_t segment_size = 16 << 20;
+
+    // Segments other than the one being written are deleted once the log
+    // exceeds max_bytes, or once they were created more than max_age ago.
+    // Zero means no limit.
+    std::uintmax_t max_bytes = 0;
+    std::chrono::system_clock::duration max_age{};
+};
+
+// Where a new LogBroadcastQueue subscriber starts reading
+enum class LogStart {
+    Tail, // items pushed after subscribing, as with BroadcastQueue
+    Head, // the oldest item still retained
+};
+
+namespace internal::log_broadcast_queue {
+
+inline std::system_error errno_error(const std::string& what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+struct alignas(64) SegmentHeader {
+    static constexpr std::uint64_t expected_magic = 0x31474f4c5142; // "BQLOG1"
+
+    std::uint64_t magic;
+    std::uint64_t item_size;
+    std::uint64_t capacity;
+    std::uint64_t first_offset;
+    std::uint64_t count;
+    std::int64_t created; // system_clock ticks since the epoch
+};
+
+// An append-only file of up to `capacity` items, mapped into memory for its
+// whole lifetime. Readers share ownership: when retention removes a segment
+// its file is unlinked straight away, but the mapping stays readable until
+// the last reader moves past it.
+template <class T> class Segment {
+public:
+    using size_type = std::size_t;
+
+    // Creates a new, empty segment file
+    Segment(std::filesystem::path path, std::uint64_t first_offset, size_type capacity) :
+        file_path(std::move(path))
+    {
+        fd = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw errno_error("LogBroadcastQueue: creating " + file_path.string());
+        length = sizeof(SegmentHeader) + capacity * sizeof(T);
+        if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+            const auto error = errno_error("LogBroadcastQueue: sizing " + file_path.string());
+            ::close(fd);
+            throw error;
+        }
+        map();
+
+        *header = SegmentHeader{
+            SegmentHeader::expected_magic,
+            sizeof(T),
+            capacity,
+            first_offset,
+            0,
+            std::chrono::system_clock::now().time_since_epoch().count(),
+        };
+    }
+
+    // Opens an existing segment file
+    explicit Segment(std::filesystem::path path) : file_path(std::move(path))
+    {
+        fd = ::open(file_path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+            throw errno_error("LogBroadcastQueue: opening " + file_path.string());
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            const auto error = errno_error("LogBroadcastQueue: opening " + file_path.string());
+            ::close(fd);
+            throw error;
+        }
+        length = static_cast<size_type>(info.st_size);
+        if (length < sizeof(SegmentHeader)) {
+            ::close(fd);
+            throw std::runtime_error("LogBroadcastQueue: truncated segment " + file_path.string());
+        }
+        map();
+
+        if (header->magic != SegmentHeader::expected_magic || header->item_size != sizeof(T)
+            || length < sizeof(SegmentHeader) + header->capacity * sizeof(T)
+            || header->count > header->capacity) {
+            unmap();
+            throw std::runtime_error("LogBroadcastQueue: invalid segment " + file_path.string());
+        }
+    }
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    ~Segment() { unmap(); }
+
+    std::uint64_t first_offset() const { return header->first_offset; }
+
+    // One past the last item written
+    std::uint64_t end_offset() const { return header->first_offset + header->count; }
+
+    bool full() const { return header->count == header->capacity; }
+
+    size_type size_bytes() const { return length; }
+
+    std::chrono::system_clock::time_point created() const
+    {
+        return std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(header->created)
+        );
+    }
+
+    const T *at(std::uint64_t offset) const { return &items[offset - header->first_offset]; }
+
+    void append(const T& item)
+    {
+        std::memcpy(static_cast<void *>(&items[header->count]), &item, sizeof(T));
+        ++header->count;
+    }
+
+    void sync() const
+    {
+        if (::msync(static_cast<void *>(header), length, MS_SYNC) != 0)
+            throw errno_error("LogBroadcastQueue: syncing " + file_path.string());
+    }
+
+    void remove()
+    {
+        std::error_code error;
+        std::filesystem::remove(file_path, error);
+    }
+
+private:
+    std::filesystem::path file_path;
+    int fd = -1;
+    size_type length = 0;
+    SegmentHeader *header = nullptr;
+    T *items = nullptr;
+
+    void map()
+    {
+        void *address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            const auto error = errno_error("LogBroadcastQueue: mapping " + file_path.string());
+            ::close(fd);
+            throw error;
+        }
+        header = static_cast<SegmentHeader *>(address);
+        items = reinterpret_cast<T *>(static_cast<char *>(address) + sizeof(SegmentHeader));
+    }
+
+    void unmap()
+    {
+        if (header)
+            ::munmap(header, length);
+        if (fd >= 0)
+            ::close(fd);
+        header = nullptr;
+        fd = -1;
+    }
+};
+
+}; // namespace internal::log_broadcast_queue
+
+/**
+ * A BroadcastQueue backed by an append-only log of memory-mapped segment
+ * files in a directory, so pushed items survive restarts and subscribers can
+ * start from any retained item rather than only from the next one pushed.
+ *
+ *   LogBroadcastQueue<Sample> log("/var/lib/app/samples", {.max_bytes = 1 << 30});
+ *   auto live = log.subscribe();                 // new items only
+ *   auto replay = log.subscribe(LogStart::Head); // everything retained
+ *   auto resumed = log.subscribe_at(saved);      // from a saved offset()
+ *
+ * Each item has an offset, its position in the log since it was created.
+ * Subscribers read items in place from the mapped files; front_span() gives
+ * the queued items that are contiguous in the current segment.
+ *
+ * Old segments are deleted according to the retention limits in LogOptions
+ * when a new segment is started. A subscriber that falls behind the oldest
+ * retained item skips ahead to it.
+ *
+ * Items must be trivially copyable, as they are written to disk byte for
+ * byte. Only one LogBroadcastQueue may use a directory at a time.
+ *
+ * NOT THREAD SAFE.
+ */
+template <class T> class LogBroadcastQueue {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "LogBroadcastQueue items must be trivially copyable");
+    static_assert(alignof(T) <= alignof(internal::log_broadcast_queue::SegmentHeader));
+
+    using value_type = T;
+    using size_type = std::size_t;
+    using offset_type = std::uint64_t;
+    using subscriber_type = LogBroadcastQueueSubscriber<T>;
+
+    // Opens the log in directory, creating it if needed. Existing segments are
+    // reopened and pushed items are appended after them.
+    explicit LogBroadcastQueue(std::filesystem::path directory, LogOptions options = {}) :
+        directory(std::move(directory)),
+        options(options),
+        segment_capacity(std::max<size_type>(1, options.segment_size / sizeof(T)))
+    {
+        std::filesystem::create_directories(this->directory);
+
+        std::vector<std::filesystem::path> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(this->directory)) {
+            if (entry.is_regular_file() && entry.path().extension() == extension)
+                paths.push_back(entry.path());
+        }
+        // File names are zero-padded offsets, so they sort in log order
+        std::sort(paths.begin(), paths.end());
+        for (const auto& path : paths)
+            segments.push_back(std::make_shared<segment_type>(path));
+    }
+
+    LogBroadcastQueue(const LogBroadcastQueue&) = delete;
+    LogBroadcastQueue& operator=(const LogBroadcastQueue&) = delete;
+    LogBroadcastQueue(LogBroadcastQueue&&) = delete;
+    LogBroadcastQueue& operator=(LogBroadcastQueue&&) = delete;
+
+    subscriber_type subscribe(LogStart start = LogStart::Tail)
+    {
+        return subscriber_type(*this, start == LogStart::Head ? head_offset() : tail_offset());
+    }
+
+    // Starts at offset, e.g. a subscriber's offset() saved before a restart.
+    // Offsets that are no longer retained start at the head instead.
+    subscriber_type subscribe_at(offset_type offset)
+    {
+        return subscriber_type(*this, std::clamp(offset, head_offset(), tail_offset()));
+    }
+
+    void push(const value_type& value)
+    {
+        if (segments.empty() || segments.back()->full())
+            roll();
+        segments.back()->append(value);
+    }
+
+    // Writes pushed items through to disk. Without this they are written back
+    // by the OS in its own time, which survives the process crashing but not
+    // the machine.
+    void sync() const
+    {
+        for (const auto& segment : segments)
+            segment->sync();
+    }
+
+    // Offset of the oldest retained item
+    offset_type head_offset() const
+    {
+        return segments.empty() ? 0 : segments.front()->first_offset();
+    }
+
+    // Offset the next pushed item will have
+    offset_type tail_offset() const { return segments.empty() ? 0 : segments.back()->end_offset(); }
+
+    size_type num_segments() const { return segments.size(); }
+
+    // Deletes the segments outside the retention limits, except the segment
+    // currently being written. Called automatically when starting a segment.
+    void enforce_retention()
+    {
+        std::uintmax_t total = 0;
+        for (const auto& segment : segments)
+            total += segment->size_bytes();
+
+        const auto now = std::chrono::system_clock::now();
+        while (segments.size() > 1) {
+            const auto& oldest = segments.front();
+            const bool too_big = options.max_bytes != 0 && total > options.max_bytes;
+            const bool too_old = options.max_age != std::chrono::system_clock::duration::zero()
+                && now - oldest->created() > options.max_age;
+            if (!too_big && !too_old)
+                break;
+            total -= oldest->size_bytes();
+            oldest->remove();
+            segments.pop_front();
+        }
+    }
+
+private:
+    friend subscriber_type;
+
+    using segment_type = internal::log_broadcast_queue::Segment<T>;
+
+    static constexpr const char *extension = ".log";
+
+    const std::filesystem::path directory;
+    const LogOptions options;
+    const size_type segment_capacity;
+    std::deque<std::shared_ptr<segment_type>> segments;
+
+    void roll()
+    {
+        const offset_type first = tail_offset();
+        char name[21] = {};
+        const auto result = std::to_chars(name, name + 20, first);
+        const std::string digits(name, result.ptr);
+        const auto path =
+            directory / (std::string(20 - digits.size(), '0') + digits + extension);
+        segments.push_back(std::make_shared<segment_type>(path, first, segment_capacity));
+        enforce_retention();
+    }
+
+    // The segment containing offset, or null if it is not retained
+    std::shared_ptr<segment_type> find(offset_type offset) const
+    {
+        auto it = std::upper_bound(
+            segments.begin(),
+            segments.end(),
+            offset,
+            [](offset_type value, const auto& segment) { return value < segment->first_offset(); }
+        );
+        if (it == segments.begin())
+            return nullptr;
+        --it;
+        return offset < (*it)->end_offset() ? *it : nullptr;
+    }
+};
+
+/**
+ * Provides the element access and capacity interfaces of std::queue<T>,
+ * except that elements are only accessible through const references.
+ */
+template <class T> class LogBroadcastQueueSubscriber {
+public:
+    using queue_type = LogBroadcastQueue<T>;
+    using value_type = typename queue_type::value_type;
+    using size_type = typename queue_type::size_type;
+    using offset_type = typename queue_type::offset_type;
+    using const_reference = const value_type&;
+
+    LogBroadcastQueueSubscriber(const LogBroadcastQueueSubscriber&) = delete;
+    LogBroadcastQueueSubscriber& operator=(const LogBroadcastQueueSubscriber&) = delete;
+    LogBroadcastQueueSubscriber(LogBroadcastQueueSubscriber&&) = delete;
+    LogBroadcastQueueSubscriber& operator=(LogBroadcastQueueSubscriber&&) = delete;
+
+    bool empty() const { return size() == 0; }
+
+    // While reading a segment deleted by retention, this includes the deleted
+    // items after it, which will be skipped.
+    size_type size() const
+    {
+        return static_cast<size_type>(controller.tail_offset() - current_offset());
+    }
+
+    const_reference back() const
+    {
+        return *controller.find(controller.tail_offset() - 1)->at(controller.tail_offset() - 1);
+    }
+
+    const_reference front() const { return *segment_at_front().at(next); }
+
+    void pop() { pop_n(1); }
+
+    // Returns the queued items, starting at front(), that are contiguous in
+    // the current segment file. It is only empty if the subscriber is
+    // empty(); the items stay valid until they are popped.
+    std::span<const value_type> front_span() const
+    {
+        if (empty())
+            return {};
+        const auto& segment = segment_at_front();
+        return {segment.at(next), static_cast<size_type>(segment.end_offset() - next)};
+    }
+
+    // Pops the first n items. n must not be greater than size().
+    void pop_n(size_type n) { next = current_offset() + n; }
+
+    // Offset of front(). Saving it allows a later subscriber, possibly after a
+    // restart, to resume from the same item with subscribe_at().
+    offset_type offset() const { return current_offset(); }
+
+private:
+    friend queue_type;
+
+    using segment_type = typename queue_type::segment_type;
+
+    queue_type& controller;
+    mutable offset_type next;
+
+    // The segment last read from. Holding it keeps it mapped if retention
+    // deletes it while items in it are still queued for this subscriber.
+    mutable std::shared_ptr<segment_type> segment;
+
+    LogBroadcastQueueSubscriber(queue_type& controller, offset_type offset) :
+        controller(controller), next(offset)
+    {}
+
+    bool in_segment(offset_type offset) const
+    {
+        return segment && offset >= segment->first_offset() && offset < segment->end_offset();
+    }
+
+    // Skips ahead if queued items have been deleted by retention
+    offset_type current_offset() const
+    {
+        if (next < controller.head_offset() && !in_segment(next))
+            next = controller.head_offset();
+        return next;
+    }
+
+    const segment_type& segment_at_front() const
+    {
+        if (!in_segment(current_offset()))
+            segment = controller.find(next);
+        return *segment;
+    }
+};
+
+}; // namespace recap::app::broadcast_queue
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../observable/observable.hpp"
+#include "concurrent-broadcast-queue.hpp"
+
+namespace recap::app::broadcast_queue {
+
+/**
+ * Delivers the notifications of an Observable<Ts...> to other threads. Each
+ * notify() pushes a std::tuple of copies of its arguments into a
+ * ConcurrentBroadcastQueue, and consumers subscribe to the queue and drain it
+ * on their own threads. Reference arguments, as in Observable<const
+ * std::string&>, are copied, since the consumers read them after notify()
+ * has returned.
+ *
+ *   Observable<int, std::string> events;
+ *   ObservableBroadcastQueue<int, std::string> queue(events, 1024);
+ *   auto sub = queue.subscribe();
+ *
+ *   // Notifying thread, which only pays for the push:
+ *   events.notify(1, "connected");
+ *
+ *   // Consumer thread, draining in batches:
+ *   for (auto batch = sub.front_span(); !batch.empty(); batch = sub.front_span()) {
+ *       for (const auto& [id, name] : batch)
+ *           use(id, name);
+ *       sub.pop_n(batch.size());
+ *   }
+ *
+ * When the queue is full, notify() either waits for the slowest subscriber
+ * (Overflow::wait) or drops the notification (Overflow::drop), which keeps
+ * the notifying thread from blocking on a slow consumer. Notifications made
+ * while there are no subscribers are discarded, as for any BroadcastQueue.
+ *
+ * The Observable and the ObservableBroadcastQueue may be destroyed in either
+ * order. The Observable must still only be notified from one thread at a
+ * time; the queue and its subscribers are thread safe as described for
+ * ConcurrentBroadcastQueue.
+ */
+template <class... Ts> class ObservableBroadcastQueue {
+public:
+    using value_type = std::tuple<std::decay_t<Ts>...>;
+    using queue_type = ConcurrentBroadcastQueue<value_type>;
+    using size_type = typename queue_type::size_type;
+    using subscriber_type = typename queue_type::subscriber_type;
+    using group_type = typename queue_type::group_type;
+
+    enum class Overflow { wait, drop };
+
+    ObservableBroadcastQueue(
+        Observable<Ts...>& observable, size_type capacity, Overflow overflow = Overflow::wait,
+        size_type max_subscribers = queue_type::default_max_subscribers
+    ) :
+        queue(capacity, max_subscribers), observer(subscribe_to(observable, overflow))
+    {}
+
+    ObservableBroadcastQueue(const ObservableBroadcastQueue&) = delete;
+    ObservableBroadcastQueue& operator=(const ObservableBroadcastQueue&) = delete;
+    ObservableBroadcastQueue(ObservableBroadcastQueue&&) = delete;
+    ObservableBroadcastQueue& operator=(ObservableBroadcastQueue&&) = delete;
+
+    // Throws std::length_error if max_subscribers are already subscribed
+    subscriber_type subscribe() { return queue.subscribe(); }
+
+    group_type subscribe_group() { return queue.subscribe_group(); }
+
+    size_type num_subscribers() const { return queue.num_subscribers(); }
+
+    size_type capacity() const { return queue.capacity(); }
+
+    // Notifications dropped because the queue was full, with Overflow::drop
+    std::uint64_t dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+
+private:
+    // Declared before the observer, so that the observer is unsubscribed
+    // before the queue is destroyed
+    queue_type queue;
+    std::atomic<std::uint64_t> num_dropped{0};
+    typename Observable<Ts...>::Observer observer;
+
+    typename Observable<Ts...>::Observer subscribe_to(Observable<Ts...>& observable, Overflow overflow)
+    {
+        if (overflow == Overflow::drop) {
+            return observable.subscribe([this](auto&&...args) {
+                if (!queue.try_emplace(std::forward<decltype(args)>(args)...))
+                    num_dropped.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        return observable.subscribe([this](auto&&...args) {
+            queue.emplace(std::forward<decltype(args)>(args)...);
+        });
+    }
+};
+
+}; // namespace recap::app::broadcast_queue
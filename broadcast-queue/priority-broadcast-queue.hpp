@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace recap::app::broadcast_queue {
+
+template <class T, std::size_t Levels, class Container> class PriorityBroadcastQueueSubscriber;
+
+/**
+ * A BroadcastQueue whose items are pushed with a priority in [0, Levels).
+ * Subscribers receive the highest priority items first, and items of equal
+ * priority in the order they were pushed.
+ *
+ *   PriorityBroadcastQueue<Message> queue;
+ *   auto sub = queue.subscribe();
+ *   queue.push(0, telemetry);
+ *   queue.push(7, shutdown);
+ *   sub.front() // returns shutdown
+ *
+ * Each subscriber has a FIFO queue per priority level and a bitmask of the
+ * non-empty levels, so a push is a queue push per subscriber and front() is
+ * a find-highest-set-bit, whatever the number of queued items.
+ *
+ * NOT THREAD SAFE.
+ */
+template <class T, std::size_t Levels = 8, class Container = std::deque<T>>
+class PriorityBroadcastQueue {
+    static_assert(Levels > 0 && Levels <= 64, "Levels must be in [1, 64]");
+
+public:
+    using value_type = T;
+    using container_type = Container;
+    using queue_type = std::queue<T, container_type>;
+    using size_type = typename queue_type::size_type;
+    using priority_type = std::size_t;
+    using subscriber_type = PriorityBroadcastQueueSubscriber<T, Levels, Container>;
+
+    static constexpr priority_type num_levels = Levels;
+
+    PriorityBroadcastQueue() = default;
+
+    PriorityBroadcastQueue(const PriorityBroadcastQueue&) = delete;
+    PriorityBroadcastQueue& operator=(const PriorityBroadcastQueue&) = delete;
+    PriorityBroadcastQueue(PriorityBroadcastQueue&&) = delete;
+    PriorityBroadcastQueue& operator=(PriorityBroadcastQueue&&) = delete;
+
+    subscriber_type subscribe()
+    {
+        return subscriber_type(
+            *this, observers.emplace(observers.end(), std::make_unique<Subscription>())
+        );
+    }
+
+    void clear()
+    {
+        for (const auto& observer : observers)
+            *observer = Subscription();
+    }
+
+    void push(priority_type priority, const T& value) { emplace(priority, value); }
+
+    void push(priority_type priority, T&& value) { emplace(priority, std::move(value)); }
+
+    // As with BroadcastQueue, the item is constructed in the last subscriber's
+    // queue and copied into the others. Throws std::out_of_range if priority
+    // is not less than Levels.
+    template <class... Args> void emplace(priority_type priority, Args&&...args)
+    {
+        if (priority >= Levels)
+            throw std::out_of_range("PriorityBroadcastQueue: priority out of range");
+        if (observers.empty())
+            return;
+
+        Subscription& last = *observers.back();
+        last.emplace(priority, std::forward<Args>(args)...);
+        const T& item = last.levels[priority].back();
+        for (auto it = observers.begin(); it->get() != &last; ++it)
+            (*it)->emplace(priority, item);
+    }
+
+    size_type num_subscribers() const { return observers.size(); }
+
+private:
+    friend subscriber_type;
+
+    struct Subscription {
+        std::array<queue_type, Levels> levels;
+        std::uint64_t non_empty = 0; // bit i is set if levels[i] is not empty
+        size_type size = 0;
+
+        template <class... Args> void emplace(priority_type priority, Args&&...args)
+        {
+            levels[priority].emplace(std::forward<Args>(args)...);
+            non_empty |= std::uint64_t(1) << priority;
+            ++size;
+        }
+
+        // Must not be called when size is 0
+        priority_type top() const { return std::bit_width(non_empty) - 1; }
+
+        void pop()
+        {
+            const priority_type priority = top();
+            queue_type& level = levels[priority];
+            level.pop();
+            if (level.empty())
+                non_empty &= ~(std::uint64_t(1) << priority);
+            --size;
+        }
+    };
+
+    using observer_list_t = std::list<std::unique_ptr<Subscription>>;
+    using handle_t = typename observer_list_t::iterator;
+
+    observer_list_t observers;
+
+    void unsubscribe(handle_t handle) { observers.erase(handle); }
+};
+
+/**
+ * Provides the same element access and capacity interfaces as std::queue<T>,
+ * except back(), with front() being the oldest of the highest priority items.
+ */
+template <class T, std::size_t Levels, class Container> class PriorityBroadcastQueueSubscriber {
+public:
+    using queue_type = PriorityBroadcastQueue<T, Levels, Container>;
+    using value_type = typename queue_type::queue_type::value_type;
+    using size_type = typename queue_type::queue_type::size_type;
+    using reference = typename queue_type::queue_type::reference;
+    using const_reference = typename queue_type::queue_type::const_reference;
+    using priority_type = typename queue_type::priority_type;
+
+    PriorityBroadcastQueueSubscriber(const PriorityBroadcastQueueSubscriber&) = delete;
+    PriorityBroadcastQueueSubscriber& operator=(const PriorityBroadcastQueueSubscriber&) = delete;
+    PriorityBroadcastQueueSubscriber(PriorityBroadcastQueueSubscriber&&) = delete;
+    PriorityBroadcastQueueSubscriber& operator=(PriorityBroadcastQueueSubscriber&&) = delete;
+
+    ~PriorityBroadcastQueueSubscriber() { controller.unsubscribe(handle); }
+
+    bool empty() const { return (*handle)->size == 0; }
+
+    const_reference front() const { return subscription().levels[priority()].front(); }
+
+    reference front() { return subscription().levels[priority()].front(); }
+
+    // The priority of front(). Must not be called when empty().
+    priority_type priority() const { return subscription().top(); }
+
+    void pop() { subscription().pop(); }
+
+    // Pops the first n items. n must not be greater than size().
+    void pop_n(size_type n)
+    {
+        for (; n > 0; --n)
+            subscription().pop();
+    }
+
+    size_type size() const { return (*handle)->size; }
+
+private:
+    friend queue_type;
+
+    queue_type& controller;
+    typename queue_type::handle_t handle;
+
+    PriorityBroadcastQueueSubscriber(queue_type& controller, typename queue_type::handle_t handle) :
+        controller(controller), handle(handle)
+    {}
+
+    typename queue_type::Subscription& subscription() const { return **handle; }
+};
+
+}; // namespace recap::app::broadcast_queue
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <span>
+#include <utility>
+
+namespace recap::app::broadcast_queue {
+
+template <class T> class SharedBroadcastQueueSubscriber;
+
+/**
+ * A BroadcastQueue that stores each pushed item once in a ring shared by all
+ * subscribers, rather than once per subscriber. Each subscriber only keeps a
+ * read cursor into the ring; a slot is destroyed once every subscriber that
+ * was subscribed when it was pushed has popped it.
+ *
+ *   SharedBroadcastQueue<int> queue;
+ *   auto sub1 = queue.subscribe();
+ *   auto sub2 = queue.subscribe();
+ *   queue.push(10);      // one copy of 10, regardless of subscriber count
+ *   sub1.front()         // returns 10
+ *   sub1.pop();
+ *   sub2.front()         // returns 10
+ *   sub2.pop();          // slot is released
+ *
+ * Since items are shared, subscribers only get const access to them.
+ *
+ * NOT THREAD SAFE.
+ */
+template <class T> class SharedBroadcastQueue {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using subscriber_type = SharedBroadcastQueueSubscriber<T>;
+
+    SharedBroadcastQueue() = default;
+
+    SharedBroadcastQueue(const SharedBroadcastQueue&) = delete;
+    SharedBroadcastQueue& operator=(const SharedBroadcastQueue&) = delete;
+    SharedBroadcastQueue(SharedBroadcastQueue&&) = delete;
+    SharedBroadcastQueue& operator=(SharedBroadcastQueue&&) = delete;
+
+    ~SharedBroadcastQueue()
+    {
+        release(tail);
+        std::allocator<T>().deallocate(values, ring_capacity);
+    }
+
+    subscriber_type subscribe()
+    {
+        return subscriber_type(*this, cursors.emplace(cursors.end(), tail));
+    }
+
+    void clear()
+    {
+        release(tail);
+        for (auto& cursor : cursors)
+            cursor = tail;
+    }
+
+    void push(const value_type& value) { emplace(value); }
+
+    void push(value_type&& value) { emplace(std::move(value)); }
+
+    size_type num_subscribers() const { return cursors.size(); }
+
+    // Number of items currently held in the ring, i.e. not yet popped by the
+    // slowest subscriber.
+    size_type size() const { return tail - head; }
+
+    size_type capacity() const { return ring_capacity; }
+
+private:
+    friend subscriber_type;
+
+    using cursor_list_t = std::list<size_type>;
+    using handle_t = typename cursor_list_t::iterator;
+
+    static constexpr size_type initial_capacity = 16;
+
+    // Ring storage. head and tail are absolute sequence numbers; the slot for
+    // sequence number s is at index (s & (ring_capacity - 1)). pending[i] is
+    // the number of subscribers that have not yet popped the item at index i.
+    T *values = nullptr;
+    std::unique_ptr<size_type[]> pending;
+    size_type ring_capacity = 0;
+    size_type head = 0;
+    size_type tail = 0;
+
+    cursor_list_t cursors;
+
+    size_type index(size_type seq) const { return seq & (ring_capacity - 1); }
+
+    T& at(size_type seq) { return values[index(seq)]; }
+
+    const T& at(size_type seq) const { return values[index(seq)]; }
+
+    template <class... Args> void emplace(Args&&...args)
+    {
+        if (cursors.empty())
+            return;
+
+        if (tail - head == ring_capacity)
+            grow();
+
+        std::construct_at(&at(tail), std::forward<Args>(args)...);
+        pending[index(tail)] = cursors.size();
+        ++tail;
+    }
+
+    // Doubles the ring capacity. Items keep their sequence numbers, so
+    // subscriber cursors are unaffected.
+    void grow()
+    {
+        size_type new_capacity = ring_capacity ? ring_capacity * 2 : initial_capacity;
+        T *new_values = std::allocator<T>().allocate(new_capacity);
+        auto new_pending = std::make_unique<size_type[]>(new_capacity);
+
+        for (size_type seq = head; seq != tail; ++seq) {
+            size_type new_index = seq & (new_capacity - 1);
+            std::construct_at(&new_values[new_index], std::move(at(seq)));
+            std::destroy_at(&at(seq));
+            new_pending[new_index] = pending[index(seq)];
+        }
+
+        std::allocator<T>().deallocate(values, ring_capacity);
+        values = new_values;
+        pending = std::move(new_pending);
+        ring_capacity = new_capacity;
+    }
+
+    // Destroys every item before sequence number `until`
+    void release(size_type until)
+    {
+        for (; head != until; ++head)
+            std::destroy_at(&at(head));
+    }
+
+    // Destroys items at the front of the ring that every subscriber has popped.
+    // Items are popped in order, so these always form a prefix of the ring.
+    void release_popped()
+    {
+        size_type until = head;
+        while (until != tail && pending[index(until)] == 0)
+            ++until;
+        release(until);
+    }
+
+    void pop(size_type& cursor, size_type n)
+    {
+        assert(tail - cursor >= n);
+        for (size_type end = cursor + n; cursor != end; ++cursor)
+            --pending[index(cursor)];
+        release_popped();
+    }
+
+    std::span<const T> span(size_type cursor) const
+    {
+        if (cursor == tail)
+            return {};
+        return {&at(cursor), std::min(tail - cursor, ring_capacity - index(cursor))};
+    }
+
+    void unsubscribe(handle_t handle)
+    {
+        for (size_type seq = *handle; seq != tail; ++seq)
+            --pending[index(seq)];
+        cursors.erase(handle);
+        release_popped();
+    }
+};
+
+/**
+ * Provides the same element access and capacity interfaces as std::queue<T>,
+ * except that elements are only accessible through const references.
+ */
+template <class T> class SharedBroadcastQueueSubscriber {
+public:
+    using queue_type = SharedBroadcastQueue<T>;
+    using value_type = typename queue_type::value_type;
+    using size_type = typename queue_type::size_type;
+    using const_reference = const value_type&;
+
+    SharedBroadcastQueueSubscriber(const SharedBroadcastQueueSubscriber&) = delete;
+    SharedBroadcastQueueSubscriber& operator=(const SharedBroadcastQueueSubscriber&) = delete;
+    SharedBroadcastQueueSubscriber(SharedBroadcastQueueSubscriber&&) = delete;
+    SharedBroadcastQueueSubscriber& operator=(SharedBroadcastQueueSubscriber&&) = delete;
+
+    ~SharedBroadcastQueueSubscriber() { controller.unsubscribe(handle); }
+
+    bool empty() const { return *handle == controller.tail; }
+
+    const_reference back() const { return controller.at(controller.tail - 1); }
+
+    const_reference front() const { return controller.at(*handle); }
+
+    void pop() { controller.pop(*handle, 1); }
+
+    // Returns the longest run of queued items, starting at front(), that is
+    // contiguous in memory. It is only empty if the subscriber is empty(); the
+    // items stay valid until they are popped. Since the ring wraps, draining a
+    // burst takes at most two spans:
+    //
+    //   for (auto items = sub.front_span(); !items.empty(); items = sub.front_span()) {
+    //       process(items);
+    //       sub.pop_n(items.size());
+    //   }
+    std::span<const value_type> front_span() const { return controller.span(*handle); }
+
+    // Pops the first n items. n must not be greater than size().
+    void pop_n(size_type n) { controller.pop(*handle, n); }
+
+    size_type size() const { return controller.tail - *handle; }
+
+private:
+    friend queue_type;
+
+    queue_type& controller;
+    typename queue_type::handle_t handle;
+
+    SharedBroadcastQueueSubscriber(queue_type& controller, typename queue_type::handle_t handle) :
+        controller(controller), handle(handle)
+    {}
+};
+
+}; // namespace recap::app::broadcast_queue
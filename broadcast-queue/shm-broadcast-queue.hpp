@@ -0,0 +1,495 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace recap::app::broadcast_queue {
+
+template <class T> class ShmBroadcastQueueSubscriber;
+
+namespace internal::shm_broadcast_queue {
+
+inline std::system_error errno_error(const std::string& what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+// Waits while word == expected, or until timeout (if not null) elapses. Not
+// FUTEX_PRIVATE, as the word is shared between processes.
+inline void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, const timespec *timeout)
+{
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t>& word)
+{
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+inline timespec to_timespec(std::chrono::nanoseconds duration)
+{
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    return {
+        static_cast<time_t>(seconds.count()),
+        static_cast<long>((duration - seconds).count()),
+    };
+}
+
+constexpr std::size_t cache_line_size = 64;
+
+constexpr std::uint64_t unused = ~std::uint64_t(0);
+
+// The segment starts with a Header, followed by max_subscribers Cursors and
+// then the ring of `capacity` items.
+struct Header {
+    static constexpr std::uint64_t expected_magic = 0x31514253484d; // "MHSBQ1"
+
+    std::atomic<std::uint64_t> magic; // written last by the creator
+    std::uint64_t item_size;
+    std::uint64_t capacity;
+    std::uint64_t max_subscribers;
+
+    // Number of items pushed. The low 32 bits are mirrored in tail_word for
+    // subscribers to futex-wait on.
+    alignas(cache_line_size) std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint32_t> tail_word;
+    std::atomic<std::uint32_t> subscribers_waiting;
+
+    // Bumped by subscribers popping while the producer waits for space
+    alignas(cache_line_size) std::atomic<std::uint32_t> space_word;
+    std::atomic<std::uint32_t> producer_waiting;
+};
+
+struct alignas(cache_line_size) Cursor {
+    std::atomic<std::uint64_t> next; // `unused` if the cursor is free
+    std::atomic<std::int32_t> pid;   // owner, to reclaim cursors of dead processes
+};
+
+inline std::size_t items_offset(std::size_t max_subscribers)
+{
+    return sizeof(Header) + max_subscribers * sizeof(Cursor);
+}
+
+}; // namespace internal::shm_broadcast_queue
+
+/**
+ * A broadcast queue in a POSIX shared memory segment, for passing items from
+ * one producer process to subscribers in any number of other processes on the
+ * same host. Subscribers read items in place in the shared ring, and neither
+ * pushing nor popping makes a syscall unless the other side is blocked
+ * waiting, in which case it is woken through a futex in the segment.
+ *
+ *   // Producer process
+ *   auto queue = ShmBroadcastQueue<Tick>::create("/ticks", 4096, 8);
+ *   queue.push(tick);
+ *
+ *   // Subscriber process
+ *   auto queue = ShmBroadcastQueue<Tick>::open("/ticks");
+ *   auto sub = queue.subscribe();
+ *   sub.wait();
+ *   handle(sub.front());
+ *   sub.pop();
+ *
+ * The segment has room for a fixed number of subscriber cursors. The
+ * producer never overwrites an item that a subscriber has not popped, so a
+ * slow subscriber holds the producer back; cursors left behind by crashed
+ * processes can be freed with reclaim_dead_subscribers().
+ *
+ * Items must be trivially copyable. Only one process (and thread) may push;
+ * each subscriber must only be used by one thread at a time.
+ */
+template <class T> class ShmBroadcastQueue {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "ShmBroadcastQueue items must be trivially copyable");
+    static_assert(alignof(T) <= internal::shm_broadcast_queue::cache_line_size);
+
+    using value_type = T;
+    using size_type = std::size_t;
+    using sequence_type = std::uint64_t;
+    using subscriber_type = ShmBroadcastQueueSubscriber<T>;
+
+    // Creates the segment `name` (which starts with a '/', as for shm_open).
+    // Fails if it already exists. capacity is rounded up to a power of two.
+    static ShmBroadcastQueue create(const std::string& name, size_type capacity, size_type max_subscribers)
+    {
+        return ShmBroadcastQueue(name, round_up_pow2(capacity), max_subscribers);
+    }
+
+    // Maps an existing segment created by create()
+    static ShmBroadcastQueue open(const std::string& name) { return ShmBroadcastQueue(name); }
+
+    // Removes the segment name; processes that have it mapped keep using it
+    static void unlink(const std::string& name) { ::shm_unlink(name.c_str()); }
+
+    ShmBroadcastQueue(const ShmBroadcastQueue&) = delete;
+    ShmBroadcastQueue& operator=(const ShmBroadcastQueue&) = delete;
+    ShmBroadcastQueue(ShmBroadcastQueue&&) = delete;
+    ShmBroadcastQueue& operator=(ShmBroadcastQueue&&) = delete;
+
+    ~ShmBroadcastQueue() { ::munmap(header, length); }
+
+    // Throws std::length_error if every cursor is in use
+    subscriber_type subscribe()
+    {
+        const std::int32_t pid = static_cast<std::int32_t>(::getpid());
+        for (size_type i = 0; i < header->max_subscribers; ++i) {
+            Cursor& cursor = cursors[i];
+            sequence_type expected = unused;
+            if (cursor.next.compare_exchange_strong(expected, header->tail.load())) {
+                cursor.pid.store(pid);
+                return subscriber_type(*this, cursor, start_cursor(cursor));
+            }
+        }
+        throw std::length_error("ShmBroadcastQueue: too many subscribers");
+    }
+
+    // Returns false without pushing if the slowest subscriber is `capacity`
+    // items behind.
+    bool try_push(const value_type& value)
+    {
+        if (full())
+            return false;
+        publish(value);
+        return true;
+    }
+
+    // Waits for the slowest subscriber if the queue is full
+    void push(const value_type& value)
+    {
+        while (full()) {
+            const std::uint32_t seen = header->space_word.load();
+            header->producer_waiting.store(1);
+            if (full())
+                internal::shm_broadcast_queue::futex_wait(header->space_word, seen, nullptr);
+            header->producer_waiting.store(0);
+        }
+        publish(value);
+    }
+
+    // Frees the cursors of subscribers whose process no longer exists.
+    // Returns the number freed.
+    size_type reclaim_dead_subscribers()
+    {
+        size_type reclaimed = 0;
+        for (size_type i = 0; i < header->max_subscribers; ++i) {
+            Cursor& cursor = cursors[i];
+            std::int32_t pid = cursor.pid.load();
+            sequence_type next = cursor.next.load();
+            if (next == unused || pid == 0 || ::kill(pid, 0) == 0 || errno != ESRCH)
+                continue;
+
+            // Another process may be reclaiming the cursor too, and a new
+            // subscriber may take it as soon as it is freed, so only the
+            // cursor that was checked is freed. Clearing the pid first means
+            // one reclaimer wins.
+            const std::int32_t dead = pid;
+            if (!cursor.pid.compare_exchange_strong(pid, 0))
+                continue;
+            if (cursor.next.compare_exchange_strong(next, unused)) {
+                ++reclaimed;
+            } else {
+                // Reclaimed and taken by a new subscriber whose pid was reused
+                cursor.pid.store(dead);
+            }
+        }
+        if (reclaimed != 0)
+            wake_producer();
+        return reclaimed;
+    }
+
+    size_type num_subscribers() const
+    {
+        size_type count = 0;
+        for (size_type i = 0; i < header->max_subscribers; ++i) {
+            if (cursors[i].next.load(std::memory_order_relaxed) != unused)
+                ++count;
+        }
+        return count;
+    }
+
+    size_type capacity() const { return header->capacity; }
+
+    size_type max_subscribers() const { return header->max_subscribers; }
+
+private:
+    friend subscriber_type;
+
+    using Header = internal::shm_broadcast_queue::Header;
+    using Cursor = internal::shm_broadcast_queue::Cursor;
+
+    static constexpr sequence_type unused = internal::shm_broadcast_queue::unused;
+
+    size_type length = 0;
+    Header *header = nullptr;
+    Cursor *cursors = nullptr;
+    T *values = nullptr;
+
+    // The producer's lower bound on every cursor, refreshed when it runs
+    // into it
+    sequence_type gate = 0;
+
+    ShmBroadcastQueue(const std::string& name, size_type capacity, size_type max_subscribers)
+    {
+        using namespace internal::shm_broadcast_queue;
+
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+            throw errno_error("ShmBroadcastQueue: creating " + name);
+        length = items_offset(max_subscribers) + capacity * sizeof(T);
+        if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+            const auto error = errno_error("ShmBroadcastQueue: sizing " + name);
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw error;
+        }
+        map(fd, name);
+
+        // The segment is zero-filled by ftruncate
+        new (header) Header();
+        header->item_size = sizeof(T);
+        header->capacity = capacity;
+        header->max_subscribers = max_subscribers;
+        locate(max_subscribers);
+        for (size_type i = 0; i < max_subscribers; ++i) {
+            new (&cursors[i]) Cursor();
+            cursors[i].next.store(unused);
+        }
+        header->magic.store(Header::expected_magic, std::memory_order_release);
+    }
+
+    explicit ShmBroadcastQueue(const std::string& name)
+    {
+        using namespace internal::shm_broadcast_queue;
+
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+            throw errno_error("ShmBroadcastQueue: opening " + name);
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_type>(info.st_size) < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("ShmBroadcastQueue: " + name + " is not initialised");
+        }
+        length = static_cast<size_type>(info.st_size);
+        map(fd, name);
+
+        if (header->magic.load(std::memory_order_acquire) != Header::expected_magic
+            || header->item_size != sizeof(T)
+            || length < items_offset(header->max_subscribers) + header->capacity * sizeof(T)) {
+            ::munmap(header, length);
+            throw std::runtime_error("ShmBroadcastQueue: " + name + " is not a compatible queue");
+        }
+        locate(header->max_subscribers);
+    }
+
+    void map(int fd, const std::string& name)
+    {
+        void *address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED)
+            throw internal::shm_broadcast_queue::errno_error("ShmBroadcastQueue: mapping " + name);
+        header = static_cast<Header *>(address);
+    }
+
+    void locate(size_type max_subscribers)
+    {
+        char *base = reinterpret_cast<char *>(header);
+        cursors = reinterpret_cast<Cursor *>(base + sizeof(Header));
+        values = reinterpret_cast<T *>(base + internal::shm_broadcast_queue::items_offset(max_subscribers));
+    }
+
+    static size_type round_up_pow2(size_type n)
+    {
+        size_type result = 1;
+        while (result < n)
+            result <<= 1;
+        return result;
+    }
+
+    size_type index(sequence_type seq) const
+    {
+        return static_cast<size_type>(seq & (header->capacity - 1));
+    }
+
+    // As for ConcurrentBroadcastQueue: re-reading the tail after storing the
+    // cursor guarantees the producer has seen the cursor before it can lap
+    // the start position.
+    sequence_type start_cursor(Cursor& cursor)
+    {
+        sequence_type start = cursor.next.load();
+        for (;;) {
+            const sequence_type current = header->tail.load();
+            if (current == start)
+                return start;
+            start = current;
+            cursor.next.store(start);
+        }
+    }
+
+    sequence_type min_cursor(sequence_type tail) const
+    {
+        sequence_type result = tail;
+        for (size_type i = 0; i < header->max_subscribers; ++i) {
+            const sequence_type next = cursors[i].next.load();
+            if (next < result)
+                result = next;
+        }
+        return result;
+    }
+
+    bool full()
+    {
+        const sequence_type tail = header->tail.load(std::memory_order_relaxed);
+        if (tail < gate + header->capacity)
+            return false;
+        gate = min_cursor(tail);
+        return tail >= gate + header->capacity;
+    }
+
+    void publish(const value_type& value)
+    {
+        const sequence_type tail = header->tail.load(std::memory_order_relaxed);
+        std::memcpy(static_cast<void *>(&values[index(tail)]), &value, sizeof(T));
+        header->tail.store(tail + 1);
+        header->tail_word.store(static_cast<std::uint32_t>(tail + 1));
+        if (header->subscribers_waiting.load() != 0)
+            internal::shm_broadcast_queue::futex_wake_all(header->tail_word);
+    }
+
+    void wake_producer()
+    {
+        if (header->producer_waiting.load() != 0) {
+            header->space_word.fetch_add(1);
+            internal::shm_broadcast_queue::futex_wake_all(header->space_word);
+        }
+    }
+};
+
+/**
+ * A reader of a ShmBroadcastQueue, holding one of the cursors in the segment.
+ * Provides the element access and capacity interfaces of std::queue<T>,
+ * except that elements are only accessible through const references.
+ */
+template <class T> class ShmBroadcastQueueSubscriber {
+public:
+    using queue_type = ShmBroadcastQueue<T>;
+    using value_type = typename queue_type::value_type;
+    using size_type = typename queue_type::size_type;
+    using const_reference = const value_type&;
+
+    ShmBroadcastQueueSubscriber(const ShmBroadcastQueueSubscriber&) = delete;
+    ShmBroadcastQueueSubscriber& operator=(const ShmBroadcastQueueSubscriber&) = delete;
+    ShmBroadcastQueueSubscriber(ShmBroadcastQueueSubscriber&&) = delete;
+    ShmBroadcastQueueSubscriber& operator=(ShmBroadcastQueueSubscriber&&) = delete;
+
+    ~ShmBroadcastQueueSubscriber()
+    {
+        cursor.pid.store(0);
+        cursor.next.store(queue_type::unused);
+        controller.wake_producer();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_type size() const
+    {
+        return static_cast<size_type>(controller.header->tail.load(std::memory_order_acquire) - position);
+    }
+
+    // Must not be called when empty()
+    const_reference front() const { return controller.values[controller.index(position)]; }
+
+    // Must not be called when empty()
+    void pop() { pop_n(1); }
+
+    // Returns the queued items, starting at front(), that are contiguous in
+    // the ring. It is only empty if the subscriber is empty(); the items stay
+    // valid until they are popped.
+    std::span<const value_type> front_span() const
+    {
+        const size_type first = controller.index(position);
+        const size_type count = std::min(size(), controller.capacity() - first);
+        return {&controller.values[first], count};
+    }
+
+    // Pops n items with a single cursor update. n must not be greater than
+    // size().
+    void pop_n(size_type n)
+    {
+        // Sequentially consistent, so that either the producer sees the new
+        // cursor or we see that it is waiting
+        position += n;
+        cursor.next.store(position);
+        controller.wake_producer();
+    }
+
+    // Blocks until an item is queued
+    void wait() { wait_until_ready(nullptr); }
+
+    // Returns false if no item was queued within timeout
+    template <class Rep, class Period> bool wait_for(std::chrono::duration<Rep, Period> timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (empty()) {
+            const auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= remaining.zero())
+                return false;
+            const timespec ts = internal::shm_broadcast_queue::to_timespec(remaining);
+            wait_until_ready(&ts);
+        }
+        return true;
+    }
+
+private:
+    friend queue_type;
+
+    using sequence_type = typename queue_type::sequence_type;
+
+    queue_type& controller;
+    typename queue_type::Cursor& cursor;
+    sequence_type position;
+
+    ShmBroadcastQueueSubscriber(
+        queue_type& controller, typename queue_type::Cursor& cursor, sequence_type position
+    ) :
+        controller(controller), cursor(cursor), position(position)
+    {}
+
+    // Sleeps until the tail moves (or timeout), unless an item is queued
+    void wait_until_ready(const timespec *timeout)
+    {
+        auto& header = *controller.header;
+        while (empty()) {
+            const std::uint32_t seen = header.tail_word.load();
+            header.subscribers_waiting.fetch_add(1);
+            if (empty())
+                internal::shm_broadcast_queue::futex_wait(header.tail_word, seen, timeout);
+            header.subscribers_waiting.fetch_sub(1);
+            if (timeout)
+                return;
+        }
+    }
+};
+
+}; // namespace recap::app::broadcast_queue
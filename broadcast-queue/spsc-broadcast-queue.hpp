@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace recap::app::broadcast_queue {
+
+template <class T> class SpscBroadcastQueueSubscriber;
+
+/**
+ * A fixed-capacity queue for one producer thread and at most one subscriber,
+ * on another thread. For the common case of a broadcast queue that only ever
+ * has one subscriber, it avoids the subscriber list and per-item allocation
+ * of BroadcastQueue, and the cursor table of ConcurrentBroadcastQueue: a push
+ * or pop is one store to an index that the other thread reads, each on its
+ * own cache line.
+ *
+ *   SpscBroadcastQueue<Event> queue(1024);
+ *   auto sub = queue.subscribe();  // on the consumer thread
+ *   queue.push(event);             // on the producer thread
+ *   sub.front();                   // returns event
+ *
+ * As with BroadcastQueue, items pushed while there is no subscriber are
+ * dropped, and a new subscriber starts with an empty queue. A second
+ * concurrent subscribe() throws std::length_error.
+ */
+template <class T> class SpscBroadcastQueue {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using subscriber_type = SpscBroadcastQueueSubscriber<T>;
+
+    // capacity is rounded up to a power of two
+    explicit SpscBroadcastQueue(size_type capacity) :
+        ring_capacity(round_up_pow2(capacity)), values(std::allocator<T>().allocate(ring_capacity))
+    {}
+
+    SpscBroadcastQueue(const SpscBroadcastQueue&) = delete;
+    SpscBroadcastQueue& operator=(const SpscBroadcastQueue&) = delete;
+    SpscBroadcastQueue(SpscBroadcastQueue&&) = delete;
+    SpscBroadcastQueue& operator=(SpscBroadcastQueue&&) = delete;
+
+    ~SpscBroadcastQueue()
+    {
+        discard(tail.load());
+        std::allocator<T>().deallocate(values, ring_capacity);
+    }
+
+    subscriber_type subscribe()
+    {
+        bool expected = false;
+        if (!subscribed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            throw std::length_error("SpscBroadcastQueue: already has a subscriber");
+        // Items pushed before subscribing, or left by a previous subscriber
+        discard(tail.load(std::memory_order_acquire));
+        return subscriber_type(*this);
+    }
+
+    // Returns false without pushing if the subscriber is `capacity` items
+    // behind. Returns true, dropping the item, if there is no subscriber.
+    bool try_push(const value_type& value) { return try_emplace(value); }
+
+    bool try_push(value_type&& value) { return try_emplace(std::move(value)); }
+
+    template <class... Args> bool try_emplace(Args&&...args)
+    {
+        if (!subscribed.load(std::memory_order_relaxed))
+            return true;
+
+        const size_type t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head >= ring_capacity) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head >= ring_capacity)
+                return false;
+        }
+        std::construct_at(&values[index(t)], std::forward<Args>(args)...);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Waits for the subscriber if the queue is full
+    void push(const value_type& value) { emplace(value); }
+
+    void push(value_type&& value) { emplace(std::move(value)); }
+
+    template <class... Args> void emplace(Args&&...args)
+    {
+        while (!try_emplace(std::forward<Args>(args)...))
+            std::this_thread::yield();
+    }
+
+    size_type num_subscribers() const { return subscribed.load(std::memory_order_relaxed) ? 1 : 0; }
+
+    size_type capacity() const { return ring_capacity; }
+
+private:
+    friend subscriber_type;
+
+    static constexpr size_type cache_line_size = 64;
+
+    const size_type ring_capacity;
+    T *const values;
+
+    std::atomic<bool> subscribed{false};
+
+    // Written by the subscriber. Items in [head, tail) are constructed.
+    alignas(cache_line_size) std::atomic<size_type> head{0};
+    size_type cached_tail = 0; // the subscriber's last read of tail
+
+    // Written by the producer
+    alignas(cache_line_size) std::atomic<size_type> tail{0};
+    size_type cached_head = 0; // the producer's last read of head
+
+    static size_type round_up_pow2(size_type n)
+    {
+        size_type result = 1;
+        while (result < n)
+            result <<= 1;
+        return result;
+    }
+
+    size_type index(size_type position) const { return position & (ring_capacity - 1); }
+
+    // Destroys the items before end. Called from the subscriber's side.
+    void discard(size_type end)
+    {
+        size_type h = head.load(std::memory_order_relaxed);
+        for (; h != end; ++h)
+            std::destroy_at(&values[index(h)]);
+        head.store(h, std::memory_order_release);
+    }
+
+    // Discards before releasing the subscription, as the next subscribe()
+    // discards from the same head, possibly on another thread
+    void unsubscribe()
+    {
+        discard(tail.load(std::memory_order_acquire));
+        subscribed.store(false, std::memory_order_release);
+    }
+};
+
+/**
+ * The reader of a SpscBroadcastQueue. Provides the element access and
+ * capacity interfaces of std::queue<T>.
+ */
+template <class T> class SpscBroadcastQueueSubscriber {
+public:
+    using queue_type = SpscBroadcastQueue<T>;
+    using value_type = typename queue_type::value_type;
+    using size_type = typename queue_type::size_type;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+    SpscBroadcastQueueSubscriber(const SpscBroadcastQueueSubscriber&) = delete;
+    SpscBroadcastQueueSubscriber& operator=(const SpscBroadcastQueueSubscriber&) = delete;
+    SpscBroadcastQueueSubscriber(SpscBroadcastQueueSubscriber&&) = delete;
+    SpscBroadcastQueueSubscriber& operator=(SpscBroadcastQueueSubscriber&&) = delete;
+
+    ~SpscBroadcastQueueSubscriber() { controller.unsubscribe(); }
+
+    bool empty() const { return available() == 0; }
+
+    size_type size() const
+    {
+        return controller.tail.load(std::memory_order_acquire)
+            - controller.head.load(std::memory_order_relaxed);
+    }
+
+    // Must not be called when empty()
+    const_reference front() const { return controller.values[controller.index(head())]; }
+
+    reference front() { return controller.values[controller.index(head())]; }
+
+    // Must not be called when empty()
+    void pop() { pop_n(1); }
+
+    bool try_pop(value_type& value)
+    {
+        if (empty())
+            return false;
+        value = std::move(front());
+        pop();
+        return true;
+    }
+
+    // Returns the queued items, starting at front(), that are contiguous in
+    // the ring. It is only empty if the subscriber is empty().
+    std::span<value_type> front_span()
+    {
+        const size_type first = controller.index(head());
+        const size_type count = std::min(available(), controller.ring_capacity - first);
+        return {&controller.values[first], count};
+    }
+
+    // Pops n items with a single index update. n must not be greater than
+    // size().
+    void pop_n(size_type n)
+    {
+        const size_type h = head();
+        for (size_type i = 0; i < n; ++i)
+            std::destroy_at(&controller.values[controller.index(h + i)]);
+        controller.head.store(h + n, std::memory_order_release);
+    }
+
+private:
+    friend queue_type;
+
+    queue_type& controller;
+
+    explicit SpscBroadcastQueueSubscriber(queue_type& controller) : controller(controller) {}
+
+    size_type head() const { return controller.head.load(std::memory_order_relaxed); }
+
+    // Items known to be published, only reading the producer's index when
+    // the cached copy runs out
+    size_type available() const
+    {
+        const size_type h = head();
+        if (controller.cached_tail <= h)
+            controller.cached_tail = controller.tail.load(std::memory_order_acquire);
+        return controller.cached_tail - h;
+    }
+};
+
+}; // namespace recap::app::broadcast_queue
@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+
+#include "bounded-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestBoundedBroadcastQueue, test_##name)
+
+namespace {
+
+struct CopyCounter {
+    static inline int copies = 0;
+    static inline int moves = 0;
+
+    int value = 0;
+
+    CopyCounter(int value) : value(value) {}
+    CopyCounter(const CopyCounter& other) : value(other.value) { ++copies; }
+    CopyCounter(CopyCounter&& other) noexcept : value(other.value) { ++moves; }
+    CopyCounter& operator=(const CopyCounter&) = default;
+    CopyCounter& operator=(CopyCounter&&) = default;
+
+    static void reset() { copies = moves = 0; }
+};
+
+}; // namespace
+
+Test(num_subscribers)
+{
+    BoundedBroadcastQueue<int> queue(4);
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    {
+        auto sub1 = queue.subscribe();
+        auto sub2 = queue.subscribe(OverflowPolicy::DropOldest);
+        ASSERT_EQ(queue.num_subscribers(), 2);
+        ASSERT_EQ(sub1.policy(), OverflowPolicy::Block);
+        ASSERT_EQ(sub2.policy(), OverflowPolicy::DropOldest);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+}
+
+Test(queuing)
+{
+    BoundedBroadcastQueue<int> queue(4);
+    queue.push(0);
+
+    auto sub1 = queue.subscribe();
+    ASSERT_TRUE(sub1.empty());
+
+    queue.push(1);
+    queue.push(2);
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.front(), 1);
+    sub1.pop();
+    ASSERT_EQ(sub1.front(), 2);
+
+    int value = 0;
+    ASSERT_TRUE(sub1.try_pop(value));
+    ASSERT_EQ(value, 2);
+    ASSERT_FALSE(sub1.try_pop(value));
+}
+
+Test(drop_oldest)
+{
+    BoundedBroadcastQueue<int> queue(3);
+    auto sub = queue.subscribe(OverflowPolicy::DropOldest);
+    for (int i = 0; i < 5; ++i)
+        queue.push(i);
+
+    ASSERT_EQ(sub.size(), 3);
+    ASSERT_EQ(sub.dropped(), 2);
+    ASSERT_EQ(sub.front(), 2);
+}
+
+Test(drop_newest)
+{
+    BoundedBroadcastQueue<int> queue(3);
+    auto sub = queue.subscribe(OverflowPolicy::DropNewest);
+    for (int i = 0; i < 5; ++i)
+        queue.push(i);
+
+    ASSERT_EQ(sub.size(), 3);
+    ASSERT_EQ(sub.dropped(), 2);
+    ASSERT_EQ(sub.front(), 0);
+}
+
+Test(disconnect)
+{
+    BoundedBroadcastQueue<int> queue(2);
+    auto sub = queue.subscribe(OverflowPolicy::Disconnect);
+    queue.push(0);
+    queue.push(1);
+    ASSERT_FALSE(sub.disconnected());
+
+    queue.push(2);
+    ASSERT_TRUE(sub.disconnected());
+    ASSERT_EQ(sub.dropped(), 1);
+
+    sub.pop();
+    sub.pop();
+    queue.push(3);
+    ASSERT_TRUE(sub.empty());
+    ASSERT_EQ(sub.dropped(), 1);
+}
+
+Test(policies_are_per_subscriber)
+{
+    BoundedBroadcastQueue<int> queue(2);
+    auto oldest = queue.subscribe(OverflowPolicy::DropOldest);
+    auto newest = queue.subscribe(OverflowPolicy::DropNewest);
+    for (int i = 0; i < 4; ++i)
+        queue.push(i);
+
+    ASSERT_EQ(oldest.front(), 2);
+    ASSERT_EQ(newest.front(), 0);
+}
+
+Test(push_moves_into_last_receiving_subscriber)
+{
+    BoundedBroadcastQueue<CopyCounter> queue(1);
+    auto sub1 = queue.subscribe(OverflowPolicy::DropOldest);
+    auto sub2 = queue.subscribe(OverflowPolicy::DropOldest);
+    auto sub3 = queue.subscribe(OverflowPolicy::DropNewest);
+
+    CopyCounter::reset();
+    queue.push(CopyCounter(1));
+    ASSERT_EQ(CopyCounter::moves, 1);
+    ASSERT_EQ(CopyCounter::copies, 2);
+
+    // sub3 is full and drops the item, so sub2 receives the rvalue
+    CopyCounter::reset();
+    ASSERT_TRUE(queue.try_push(CopyCounter(2)));
+    ASSERT_EQ(CopyCounter::moves, 1);
+    ASSERT_EQ(CopyCounter::copies, 1);
+
+    CopyCounter::reset();
+    const CopyCounter value(3);
+    queue.push(value);
+    ASSERT_EQ(CopyCounter::moves, 0);
+    ASSERT_EQ(CopyCounter::copies, 2);
+
+    queue.emplace(4);
+    ASSERT_EQ(sub1.front().value, 4);
+    ASSERT_EQ(sub2.front().value, 4);
+    ASSERT_EQ(sub3.front().value, 1);
+    ASSERT_EQ(sub3.dropped(), 3);
+}
+
+Test(block)
+{
+    BoundedBroadcastQueue<int> queue(2);
+    auto sub = queue.subscribe(OverflowPolicy::Block);
+    queue.push(0);
+    queue.push(1);
+    ASSERT_FALSE(queue.try_push(2));
+
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] {
+        queue.push(2);
+        pushed.store(true);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(pushed.load());
+
+    sub.pop();
+    producer.join();
+    ASSERT_TRUE(pushed.load());
+    ASSERT_EQ(sub.size(), 2);
+    ASSERT_EQ(sub.dropped(), 0);
+}
+
+Test(unsubscribe_unblocks_producer)
+{
+    BoundedBroadcastQueue<int> queue(1);
+    auto other = queue.subscribe(OverflowPolicy::DropNewest);
+    std::thread producer;
+    {
+        auto sub = queue.subscribe(OverflowPolicy::Block);
+        queue.push(0);
+        producer = std::thread([&] { queue.push(1); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    producer.join();
+    ASSERT_EQ(other.dropped(), 1);
+}
+
+Test(clear)
+{
+    BoundedBroadcastQueue<int> queue(4);
+    auto sub = queue.subscribe();
+    queue.push(1);
+    queue.push(2);
+    queue.clear();
+    ASSERT_TRUE(sub.empty());
+}
+
+Test(wait)
+{
+    BoundedBroadcastQueue<int> queue(4);
+    auto sub = queue.subscribe();
+
+    std::thread producer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        queue.push(1);
+    });
+    sub.wait();
+    ASSERT_EQ(sub.front(), 1);
+    producer.join();
+
+    // Returns immediately when an item is already queued
+    sub.wait();
+}
+
+Test(wait_for)
+{
+    BoundedBroadcastQueue<int> queue(4);
+    auto sub = queue.subscribe();
+    ASSERT_FALSE(sub.wait_for(std::chrono::milliseconds(1)));
+
+    std::thread producer([&] { queue.push(1); });
+    ASSERT_TRUE(sub.wait_for(std::chrono::seconds(10)));
+    producer.join();
+}
+
+Test(ready_fd)
+{
+    BoundedBroadcastQueue<int> queue(4);
+    auto sub = queue.subscribe();
+    pollfd fd{sub.ready_fd(), POLLIN, 0};
+    ASSERT_GE(fd.fd, 0);
+    ASSERT_EQ(sub.ready_fd(), fd.fd);
+
+    ASSERT_EQ(::poll(&fd, 1, 0), 0);
+
+    queue.push(1);
+    queue.push(2);
+    ASSERT_EQ(::poll(&fd, 1, 0), 1);
+    sub.pop();
+    ASSERT_EQ(::poll(&fd, 1, 0), 1);
+    sub.pop();
+    ASSERT_EQ(::poll(&fd, 1, 0), 0);
+
+    queue.push(3);
+    ASSERT_EQ(::poll(&fd, 1, 0), 1);
+    queue.clear();
+    ASSERT_EQ(::poll(&fd, 1, 0), 0);
+}
+
+namespace {
+
+// A coroutine that starts eagerly and is destroyed when it finishes
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+Task consume(BoundedBroadcastQueueSubscriber<int>& sub, std::vector<int>& received, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        auto value = co_await sub.next();
+        if (!value)
+            co_return;
+        received.push_back(*value);
+    }
+}
+
+}; // namespace
+
+Test(co_await_next)
+{
+    BoundedBroadcastQueue<int> queue(2);
+    auto sub = queue.subscribe(OverflowPolicy::Disconnect);
+    std::vector<int> received;
+
+    queue.push(1);
+    consume(sub, received, 3);
+    ASSERT_EQ(received, std::vector<int>{1});
+
+    // The suspended coroutine runs inside push
+    queue.push(2);
+    ASSERT_EQ(received, (std::vector<int>{1, 2}));
+    queue.push(3);
+    ASSERT_EQ(received, (std::vector<int>{1, 2, 3}));
+
+    // The coroutine has finished, so later items stay queued
+    queue.push(4);
+    ASSERT_EQ(sub.size(), 1);
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <deque>
+#include <thread>
+
+#include "broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestBroadcastQueueMetrics, test_##name)
+
+template <class T> using MetricsQueue = BroadcastQueue<T, std::deque<T>, WithMetrics>;
+
+Test(counts)
+{
+    MetricsQueue<int> queue;
+    auto sub = queue.subscribe();
+
+    auto metrics = sub.metrics();
+    ASSERT_EQ(metrics.pushed, 0);
+    ASSERT_EQ(metrics.popped, 0);
+    ASSERT_EQ(metrics.depth, 0);
+    ASSERT_EQ(metrics.max_depth, 0);
+    ASSERT_FALSE(metrics.last_pop);
+
+    for (int i = 0; i < 5; ++i)
+        queue.push(i);
+    sub.pop();
+    sub.pop_n(2);
+
+    metrics = sub.metrics();
+    ASSERT_EQ(metrics.pushed, 5);
+    ASSERT_EQ(metrics.popped, 3);
+    ASSERT_EQ(metrics.depth, 2);
+    ASSERT_EQ(metrics.max_depth, 5);
+    ASSERT_TRUE(metrics.last_pop);
+
+    queue.clear();
+    metrics = sub.metrics();
+    ASSERT_EQ(metrics.depth, 0);
+    ASSERT_EQ(metrics.max_depth, 5);
+}
+
+Test(filtered_items_not_counted)
+{
+    MetricsQueue<int> queue;
+    auto all = queue.subscribe();
+    auto even = queue.subscribe([](int value) { return value % 2 == 0; });
+
+    for (int i = 0; i < 4; ++i)
+        queue.emplace(i);
+
+    ASSERT_EQ(all.metrics().pushed, 4);
+    ASSERT_EQ(even.metrics().pushed, 2);
+}
+
+Test(lag)
+{
+    MetricsQueue<int> queue;
+    auto sub = queue.subscribe();
+    ASSERT_EQ(sub.metrics().lag.count(), 0);
+
+    queue.push(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    queue.push(2);
+    ASSERT_GE(sub.metrics().lag, std::chrono::milliseconds(5));
+
+    sub.pop();
+    ASSERT_LT(sub.metrics().lag, std::chrono::milliseconds(5));
+    sub.pop();
+    ASSERT_EQ(sub.metrics().lag.count(), 0);
+}
+
+Test(queue_snapshot)
+{
+    MetricsQueue<int> queue;
+    auto fast = queue.subscribe();
+    auto slow = queue.subscribe();
+
+    for (int i = 0; i < 3; ++i)
+        queue.push(i);
+    fast.pop_n(fast.size());
+
+    const auto metrics = queue.metrics();
+    ASSERT_EQ(metrics.size(), 2);
+    ASSERT_EQ(metrics[0].depth, 0);
+    ASSERT_EQ(metrics[1].depth, 3);
+}
+
+Test(mixed_with_queues_without_metrics)
+{
+    static_assert(!BroadcastQueue<int>::metrics_enabled);
+    static_assert(MetricsQueue<int>::metrics_enabled);
+    static_assert(pmr::BroadcastQueue<int, WithMetrics>::metrics_enabled);
+
+    BroadcastQueue<int> plain;
+    MetricsQueue<int> counted;
+    auto plain_sub = plain.subscribe();
+    auto counted_sub = counted.subscribe();
+    plain.push(1);
+    counted.push(1);
+    ASSERT_EQ(plain_sub.front(), counted_sub.front());
+    ASSERT_EQ(counted_sub.metrics().depth, 1);
+}
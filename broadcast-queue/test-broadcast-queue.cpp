@@ -1,11 +1,40 @@
 #include <gtest/gtest.h>
 
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "arena-resource.hpp"
 #include "broadcast-queue.hpp"
 
 using namespace recap::app::broadcast_queue;
 
 #define Test(name) TEST(TestBroadcastQueue, test_##name)
 
+namespace {
+
+struct CopyCounter {
+    static inline int copies = 0;
+    static inline int moves = 0;
+
+    int value = 0;
+
+    CopyCounter(int value) : value(value) {}
+    CopyCounter(const CopyCounter& other) : value(other.value) { ++copies; }
+    CopyCounter(CopyCounter&& other) noexcept : value(other.value) { ++moves; }
+    CopyCounter& operator=(const CopyCounter&) = default;
+    CopyCounter& operator=(CopyCounter&&) = default;
+
+    static void reset() { copies = moves = 0; }
+};
+
+}; // namespace
+
 Test(num_subscribers)
 {
     BroadcastQueue<int> queue;
@@ -147,3 +176,236 @@ Test(clear)
     ASSERT_TRUE(sub2.empty());
     ASSERT_EQ(sub2.size(), 0);
 }
+
+Test(pop_n)
+{
+    BroadcastQueue<int> queue;
+    auto sub = queue.subscribe();
+    for (int i = 0; i < 5; ++i)
+        queue.push(i);
+
+    sub.pop_n(3);
+    ASSERT_EQ(sub.size(), 2);
+    ASSERT_EQ(sub.front(), 3);
+    sub.pop_n(2);
+    ASSERT_TRUE(sub.empty());
+}
+
+Test(push_moves_into_last_subscriber)
+{
+    BroadcastQueue<CopyCounter> queue;
+    auto sub1 = queue.subscribe();
+    auto sub2 = queue.subscribe();
+    auto sub3 = queue.subscribe();
+
+    CopyCounter::reset();
+    queue.push(CopyCounter(1));
+    ASSERT_EQ(CopyCounter::moves, 1);
+    ASSERT_EQ(CopyCounter::copies, 2);
+
+    CopyCounter::reset();
+    const CopyCounter value(2);
+    queue.push(value);
+    ASSERT_EQ(CopyCounter::moves, 0);
+    ASSERT_EQ(CopyCounter::copies, 3);
+
+    ASSERT_EQ(sub1.back().value, 2);
+    ASSERT_EQ(sub2.front().value, 1);
+    ASSERT_EQ(sub3.size(), 2);
+}
+
+Test(emplace)
+{
+    BroadcastQueue<std::pair<int, std::string>> queue;
+    queue.emplace(0, "dropped");
+
+    auto sub1 = queue.subscribe();
+    auto sub2 = queue.subscribe();
+    queue.emplace(1, "one");
+    queue.emplace(2, std::string(3, 'x'));
+
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.front(), std::make_pair(1, std::string("one")));
+    ASSERT_EQ(sub2.back(), std::make_pair(2, std::string("xxx")));
+}
+
+Test(shared_payload)
+{
+    BroadcastQueue<SharedPayload<CopyCounter>> queue;
+    auto sub1 = queue.subscribe();
+    auto sub2 = queue.subscribe();
+    auto sub3 = queue.subscribe();
+    static_assert(std::is_same_v<decltype(sub1.front()), const CopyCounter&>);
+
+    CopyCounter::reset();
+    const CopyCounter value(1);
+    queue.push(value);
+    queue.push(CopyCounter(2));
+    queue.emplace(3);
+    ASSERT_EQ(CopyCounter::copies, 1);
+    ASSERT_EQ(CopyCounter::moves, 1);
+
+    ASSERT_EQ(&sub1.front(), &sub2.front());
+    ASSERT_EQ(&sub1.back(), &sub3.back());
+    ASSERT_EQ(sub2.back().value, 3);
+
+    auto shared = std::make_shared<const CopyCounter>(4);
+    queue.push(shared);
+    ASSERT_EQ(&sub1.back(), shared.get());
+    ASSERT_EQ(shared.use_count(), 4);
+
+    sub1.pop_n(4);
+    sub2.pop_n(4);
+    ASSERT_EQ(sub3.front().value, 1);
+    ASSERT_EQ(shared.use_count(), 2);
+    queue.clear();
+    ASSERT_EQ(shared.use_count(), 1);
+}
+
+Test(filtered_subscribe)
+{
+    BroadcastQueue<int> queue;
+    auto all = queue.subscribe();
+    auto even = queue.subscribe([](int i) { return i % 2 == 0; });
+    auto none = queue.subscribe([](int) { return false; });
+
+    for (int i = 0; i < 5; ++i)
+        queue.push(i);
+    queue.emplace(6);
+
+    ASSERT_EQ(all.size(), 6);
+    ASSERT_EQ(even.size(), 4);
+    ASSERT_TRUE(none.empty());
+    ASSERT_EQ(even.front(), 0);
+    even.pop();
+    ASSERT_EQ(even.front(), 2);
+    ASSERT_EQ(even.back(), 6);
+}
+
+Test(filtered_push_moves_into_last_match)
+{
+    BroadcastQueue<CopyCounter> queue;
+    auto sub1 = queue.subscribe([](const CopyCounter& c) { return c.value > 0; });
+    auto sub2 = queue.subscribe([](const CopyCounter& c) { return c.value > 1; });
+    auto sub3 = queue.subscribe([](const CopyCounter& c) { return c.value > 2; });
+
+    CopyCounter::reset();
+    queue.push(CopyCounter(2));
+    ASSERT_EQ(CopyCounter::copies, 1);
+    ASSERT_EQ(sub1.size(), 1);
+    ASSERT_EQ(sub2.size(), 1);
+    ASSERT_TRUE(sub3.empty());
+}
+
+Test(filtered_shared_payload)
+{
+    BroadcastQueue<SharedPayload<std::string>> queue;
+    auto sub1 = queue.subscribe([](const std::string& s) { return s.size() > 3; });
+    auto sub2 = queue.subscribe();
+    queue.push("abc");
+    queue.push("abcd");
+
+    ASSERT_EQ(sub1.size(), 1);
+    ASSERT_EQ(sub2.size(), 2);
+    ASSERT_EQ(&sub1.front(), &sub2.back());
+}
+
+namespace {
+
+// Counts the allocations passed on to the default resource
+struct CountingResource : std::pmr::memory_resource {
+    int allocations = 0;
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+}; // namespace
+
+Test(pmr_allocates_from_resource)
+{
+    CountingResource resource;
+    {
+        pmr::BroadcastQueue<int> queue(&resource);
+        auto sub1 = queue.subscribe();
+        auto sub2 = queue.subscribe();
+        ASSERT_GT(resource.allocations, 0);
+
+        queue.push(1);
+        ASSERT_EQ(sub1.front(), 1);
+        ASSERT_EQ(sub2.front(), 1);
+    }
+
+    resource.allocations = 0;
+    {
+        pmr::BroadcastQueue<SharedPayload<std::string>> queue(&resource);
+        auto sub = queue.subscribe();
+        const int subscribed = resource.allocations;
+        queue.push("abc");
+        ASSERT_GT(resource.allocations, subscribed); // the shared payload
+        ASSERT_EQ(sub.front(), "abc");
+    }
+
+    // The push times kept WithMetrics come from the resource too, so it
+    // serves more allocations than the same queue without metrics
+    auto count_allocations = [&resource]<class Queue>(Queue& queue) {
+        auto sub = queue.subscribe();
+        resource.allocations = 0;
+        for (int i = 0; i < 1000; ++i)
+            queue.push(i);
+        sub.pop_n(500);
+        return resource.allocations;
+    };
+    pmr::BroadcastQueue<int> plain(&resource);
+    pmr::BroadcastQueue<int, WithMetrics> measured(&resource);
+    const int plain_allocations = count_allocations(plain);
+    ASSERT_GT(count_allocations(measured), plain_allocations);
+}
+
+Test(arena_resource)
+{
+    CountingResource upstream;
+    ArenaResource arena(1 << 16, &upstream);
+    {
+        pmr::BroadcastQueue<int> queue(&arena);
+        auto sub1 = queue.subscribe();
+        auto sub2 = queue.subscribe();
+        for (int round = 0; round < 100; ++round) {
+            for (int i = 0; i < 1000; ++i)
+                queue.push(i);
+            ASSERT_EQ(sub1.size(), 1000);
+            ASSERT_EQ(sub2.back(), 999);
+            sub1.pop_n(sub1.size());
+            sub2.pop_n(sub2.size());
+        }
+    }
+    // The freed deque chunks were reused rather than taking more of the arena
+    ASSERT_EQ(upstream.allocations, 0);
+}
+
+Test(arena_resource_exhausted)
+{
+    std::array<std::byte, 4096> buffer;
+    ArenaResource arena(buffer);
+    pmr::BroadcastQueue<std::array<char, 1024>> queue(&arena);
+    ASSERT_THROW(
+        {
+            auto sub = queue.subscribe();
+            queue.push({});
+        },
+        std::bad_alloc
+    );
+}
@@ -0,0 +1,392 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "concurrent-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestConcurrentBroadcastQueue, test_##name)
+
+Test(num_subscribers)
+{
+    ConcurrentBroadcastQueue<int> queue(8, 3);
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    {
+        auto sub1 = queue.subscribe();
+        auto sub2 = queue.subscribe();
+        {
+            auto sub3 = queue.subscribe();
+            ASSERT_EQ(queue.num_subscribers(), 3);
+            ASSERT_THROW(queue.subscribe(), std::length_error);
+        }
+        ASSERT_EQ(queue.num_subscribers(), 2);
+        auto sub3 = queue.subscribe();
+        ASSERT_EQ(queue.num_subscribers(), 3);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+}
+
+Test(queuing)
+{
+    ConcurrentBroadcastQueue<int> queue(8);
+    queue.push(0);
+
+    auto sub1 = queue.subscribe();
+    ASSERT_TRUE(sub1.empty());
+    ASSERT_EQ(sub1.size(), 0);
+
+    queue.push(1);
+    queue.push(2);
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.front(), 1);
+
+    auto sub2 = queue.subscribe();
+    queue.push(3);
+    ASSERT_EQ(sub2.size(), 1);
+    ASSERT_EQ(sub2.front(), 3);
+
+    sub1.pop();
+    ASSERT_EQ(sub1.front(), 2);
+    sub1.pop();
+    ASSERT_EQ(sub1.front(), 3);
+    sub1.pop();
+    ASSERT_TRUE(sub1.empty());
+
+    int value = 0;
+    ASSERT_TRUE(sub2.try_pop(value));
+    ASSERT_EQ(value, 3);
+    ASSERT_FALSE(sub2.try_pop(value));
+}
+
+Test(full_queue_waits_for_slowest_subscriber)
+{
+    ConcurrentBroadcastQueue<int> queue(4);
+    ASSERT_EQ(queue.capacity(), 4);
+
+    auto fast = queue.subscribe();
+    auto slow = queue.subscribe();
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.try_push(i));
+        fast.pop();
+    }
+    ASSERT_FALSE(queue.try_push(4));
+
+    slow.pop();
+    ASSERT_TRUE(queue.try_push(4));
+    ASSERT_FALSE(queue.try_push(5));
+}
+
+Test(front_span)
+{
+    ConcurrentBroadcastQueue<int> queue(8);
+    auto sub = queue.subscribe();
+    ASSERT_TRUE(sub.front_span().empty());
+
+    for (int i = 0; i < 6; ++i)
+        queue.push(i);
+    auto items = sub.front_span();
+    ASSERT_EQ(items.size(), 6);
+    ASSERT_EQ(&items.front(), &sub.front());
+    sub.pop_n(6);
+    ASSERT_TRUE(sub.empty());
+
+    // The ring wraps after two more items
+    for (int i = 6; i < 12; ++i)
+        queue.push(i);
+    items = sub.front_span();
+    ASSERT_EQ(items.size(), 2);
+    ASSERT_EQ(items[0], 6);
+    sub.pop_n(items.size());
+    items = sub.front_span();
+    ASSERT_EQ(items.size(), 4);
+    ASSERT_EQ(items[3], 11);
+}
+
+Test(no_subscribers_never_blocks)
+{
+    ConcurrentBroadcastQueue<int> queue(4);
+    for (int i = 0; i < 100; ++i)
+        ASSERT_TRUE(queue.try_push(i));
+}
+
+// Counts live instances, and throws when constructed from a negative value
+struct ThrowingItem {
+    static inline int live = 0;
+    int value;
+
+    explicit ThrowingItem(int value) : value(value)
+    {
+        if (value < 0)
+            throw std::invalid_argument("negative");
+        ++live;
+    }
+
+    ThrowingItem(const ThrowingItem& other) : value(other.value) { ++live; }
+
+    ThrowingItem(ThrowingItem&& other) noexcept : value(other.value) { ++live; }
+
+    ThrowingItem& operator=(const ThrowingItem&) = default;
+
+    ~ThrowingItem() { --live; }
+};
+
+Test(throwing_constructor_pushes_nothing)
+{
+    {
+        ConcurrentBroadcastQueue<ThrowingItem> queue(2);
+        auto sub = queue.subscribe();
+        queue.push(ThrowingItem(0));
+        sub.pop();
+        queue.push(ThrowingItem(1));
+
+        // The next push reuses the first slot
+        ASSERT_THROW(queue.emplace(-1), std::invalid_argument);
+        ASSERT_THROW(queue.try_emplace(-1), std::invalid_argument);
+        ASSERT_EQ(sub.size(), 1);
+        ASSERT_EQ(ThrowingItem::live, 2);
+
+        // The queue is still usable, and laps the ring without waiting
+        const ThrowingItem item(2);
+        ASSERT_TRUE(queue.try_push(item));
+        sub.pop_n(2);
+        queue.emplace(3);
+        queue.emplace(4);
+        ASSERT_EQ(sub.front().value, 3);
+    }
+    ASSERT_EQ(ThrowingItem::live, 0);
+}
+
+// Run with ThreadSanitizer. Several producers push tagged, increasing values
+// while subscribers consume them and others subscribe and unsubscribe.
+Test(stress)
+{
+    constexpr int num_producers = 4;
+    constexpr int num_consumers = 4;
+    constexpr int items_per_producer = 20000;
+
+    struct Item {
+        int producer;
+        int value;
+    };
+
+    ConcurrentBroadcastQueue<Item> queue(256);
+
+    std::atomic<int> ready{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+
+    for (int c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&] {
+            auto sub = queue.subscribe();
+            ready.fetch_add(1);
+
+            std::vector<int> last(num_producers, -1);
+            for (int received = 0; received < num_producers * items_per_producer;) {
+                if (sub.empty()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const Item& item = sub.front();
+                EXPECT_EQ(item.value, last[item.producer] + 1);
+                last[item.producer] = item.value;
+                sub.pop();
+                ++received;
+            }
+        });
+    }
+
+    threads.emplace_back([&] {
+        while (!done.load()) {
+            auto sub = queue.subscribe();
+            std::vector<int> last(num_producers, -1);
+            Item item{};
+            for (int i = 0; i < 100; ++i) {
+                if (sub.try_pop(item)) {
+                    EXPECT_GT(item.value, last[item.producer]);
+                    last[item.producer] = item.value;
+                }
+            }
+        }
+    });
+
+    while (ready.load() != num_consumers)
+        std::this_thread::yield();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < items_per_producer; ++i)
+                queue.push(Item{p, i});
+        });
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+    done.store(true);
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(queue.num_subscribers(), 0);
+}
+
+Test(group)
+{
+    ConcurrentBroadcastQueue<int> queue(4, 4);
+    auto sub = queue.subscribe();
+    auto group = queue.subscribe_group();
+    ASSERT_EQ(queue.num_subscribers(), 2);
+
+    auto worker1 = group.subscribe();
+    auto worker2 = group.subscribe();
+    ASSERT_EQ(queue.num_subscribers(), 2);
+    ASSERT_THROW(group.subscribe(), std::length_error);
+
+    for (int i = 0; i < 3; ++i)
+        queue.push(i);
+    ASSERT_EQ(group.size(), 3);
+
+    int value = -1;
+    ASSERT_TRUE(worker1.try_pop(value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(worker2.try_pop(value));
+    ASSERT_EQ(value, 1);
+    ASSERT_TRUE(worker1.try_pop(value));
+    ASSERT_EQ(value, 2);
+    ASSERT_FALSE(worker2.try_pop(value));
+    ASSERT_TRUE(group.empty());
+
+    // The other subscriber still receives everything
+    ASSERT_EQ(sub.size(), 3);
+}
+
+Test(group_gates_producers)
+{
+    ConcurrentBroadcastQueue<int> queue(2);
+    auto group = queue.subscribe_group();
+    auto worker = group.subscribe();
+    ASSERT_TRUE(queue.try_push(1));
+    ASSERT_TRUE(queue.try_push(2));
+    ASSERT_FALSE(queue.try_push(3));
+
+    int value = 0;
+    ASSERT_TRUE(worker.try_pop(value));
+    ASSERT_TRUE(queue.try_push(3));
+    ASSERT_TRUE(worker.try_pop(value));
+    ASSERT_EQ(value, 2);
+    ASSERT_TRUE(worker.try_pop(value));
+    ASSERT_EQ(value, 3);
+}
+
+// Run with ThreadSanitizer. Every item reaches exactly one worker of each
+// group, while a plain subscriber receives all of them.
+Test(group_stress)
+{
+    constexpr int num_producers = 2;
+    constexpr int num_workers = 3;
+    constexpr int items_per_producer = 20000;
+    constexpr int num_items = num_producers * items_per_producer;
+
+    ConcurrentBroadcastQueue<int> queue(128);
+    auto group1 = queue.subscribe_group();
+    auto group2 = queue.subscribe_group();
+    auto sub = queue.subscribe();
+
+    std::vector<std::atomic<int>> taken(num_items);
+    std::atomic<int> remaining{2 * num_items};
+    std::vector<std::thread> threads;
+    for (auto *group : {&group1, &group2}) {
+        for (int w = 0; w < num_workers; ++w) {
+            threads.emplace_back([&, group] {
+                auto worker = group->subscribe();
+                int value;
+                while (remaining.load() > 0) {
+                    if (worker.try_pop(value)) {
+                        taken[value].fetch_add(1);
+                        remaining.fetch_sub(1);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+    }
+    threads.emplace_back([&] {
+        for (int received = 0; received < num_items;) {
+            const auto items = sub.front_span();
+            if (items.empty()) {
+                std::this_thread::yield();
+                continue;
+            }
+            received += static_cast<int>(items.size());
+            sub.pop_n(items.size());
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < items_per_producer; ++i)
+                queue.push(p * items_per_producer + i);
+        });
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+    for (auto& thread : threads)
+        thread.join();
+
+    for (int i = 0; i < num_items; ++i)
+        ASSERT_EQ(taken[i].load(), 2) << i;
+}
+
+// Run with ThreadSanitizer. The workers' cursors come before their group's in
+// the cursor array, so producers read them first when looking for the
+// slowest cursor. Items are strings that are freed when their slot is
+// reused, so a slot reused while a worker copies from it is reported.
+Test(group_workers_before_group_cursor)
+{
+    constexpr int num_workers = 3;
+    constexpr int num_items = 20000;
+
+    struct Placeholder {
+        ConcurrentBroadcastQueueSubscriber<std::string> sub;
+    };
+
+    ConcurrentBroadcastQueue<std::string> queue(4, num_workers + 1);
+    std::vector<std::unique_ptr<Placeholder>> placeholders;
+    for (int w = 0; w < num_workers; ++w)
+        placeholders.emplace_back(new Placeholder{queue.subscribe()});
+    auto group = queue.subscribe_group();
+    placeholders.clear();
+
+    std::atomic<int> remaining{num_items};
+    std::vector<std::thread> workers;
+    for (int w = 0; w < num_workers; ++w) {
+        workers.emplace_back([&] {
+            auto worker = group.subscribe();
+            std::string value;
+            while (remaining.load() > 0) {
+                if (worker.try_pop(value)) {
+                    EXPECT_EQ(value, std::string(64, value[0]));
+                    remaining.fetch_sub(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < num_items; ++i)
+        queue.push(std::string(64, static_cast<char>('a' + i % 26)));
+
+    for (auto& worker : workers)
+        worker.join();
+    ASSERT_EQ(remaining.load(), 0);
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "log-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestLogBroadcastQueue, test_##name)
+
+namespace {
+
+struct Sample {
+    int id;
+    double value;
+};
+
+// A fresh directory for each test, deleted afterwards
+class LogDirectory {
+public:
+    LogDirectory() :
+        path(std::filesystem::temp_directory_path()
+             / ("test-log-broadcast-queue-" + std::to_string(::getpid()) + "-"
+                + ::testing::UnitTest::GetInstance()->current_test_info()->name()))
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    ~LogDirectory() { std::filesystem::remove_all(path); }
+
+    std::size_t num_files() const
+    {
+        std::size_t count = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(path))
+            ++count;
+        return count;
+    }
+
+    const std::filesystem::path path;
+};
+
+template <class Subscriber> std::vector<int> drain(Subscriber& sub)
+{
+    std::vector<int> items;
+    while (!sub.empty()) {
+        items.push_back(sub.front());
+        sub.pop();
+    }
+    return items;
+}
+
+}; // namespace
+
+Test(queuing)
+{
+    LogDirectory dir;
+    LogBroadcastQueue<int> queue(dir.path);
+    queue.push(0);
+
+    auto sub1 = queue.subscribe();
+    ASSERT_TRUE(sub1.empty());
+    queue.push(1);
+    queue.push(2);
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.front(), 1);
+    ASSERT_EQ(sub1.back(), 2);
+
+    auto sub2 = queue.subscribe();
+    queue.push(3);
+    ASSERT_EQ(drain(sub1), (std::vector<int>{1, 2, 3}));
+    ASSERT_EQ(drain(sub2), (std::vector<int>{3}));
+}
+
+Test(subscribe_at_head)
+{
+    LogDirectory dir;
+    LogBroadcastQueue<int> queue(dir.path);
+    for (int i = 0; i < 5; ++i)
+        queue.push(i);
+
+    auto sub = queue.subscribe(LogStart::Head);
+    ASSERT_EQ(sub.offset(), 0);
+    ASSERT_EQ(drain(sub), (std::vector<int>{0, 1, 2, 3, 4}));
+    ASSERT_EQ(sub.offset(), 5);
+}
+
+Test(resume_after_reopening)
+{
+    LogDirectory dir;
+    LogBroadcastQueue<int>::offset_type saved;
+    {
+        LogBroadcastQueue<int> queue(dir.path, {.segment_size = 4 * sizeof(int)});
+        auto sub = queue.subscribe();
+        for (int i = 0; i < 10; ++i)
+            queue.push(i);
+        sub.pop_n(6);
+        saved = sub.offset();
+        queue.sync();
+    }
+
+    LogBroadcastQueue<int> queue(dir.path, {.segment_size = 4 * sizeof(int)});
+    ASSERT_EQ(queue.head_offset(), 0);
+    ASSERT_EQ(queue.tail_offset(), 10);
+    queue.push(10);
+
+    auto sub = queue.subscribe_at(saved);
+    ASSERT_EQ(drain(sub), (std::vector<int>{6, 7, 8, 9, 10}));
+}
+
+Test(segments_and_spans)
+{
+    LogDirectory dir;
+    LogBroadcastQueue<Sample> queue(dir.path, {.segment_size = 3 * sizeof(Sample)});
+    auto sub = queue.subscribe();
+    for (int i = 0; i < 7; ++i)
+        queue.push({i, i * 0.5});
+    ASSERT_EQ(queue.num_segments(), 3);
+    ASSERT_EQ(dir.num_files(), 3);
+
+    std::vector<std::size_t> span_sizes;
+    std::vector<int> ids;
+    for (auto items = sub.front_span(); !items.empty(); items = sub.front_span()) {
+        span_sizes.push_back(items.size());
+        for (const Sample& sample : items)
+            ids.push_back(sample.id);
+        sub.pop_n(items.size());
+    }
+    ASSERT_EQ(span_sizes, (std::vector<std::size_t>{3, 3, 1}));
+    ASSERT_EQ(ids, (std::vector<int>{0, 1, 2, 3, 4, 5, 6}));
+}
+
+Test(retention_by_size)
+{
+    LogDirectory dir;
+    const std::size_t segment_size = 4 * sizeof(int);
+    LogBroadcastQueue<int> queue(
+        dir.path, {.segment_size = segment_size, .max_bytes = 2 * (64 + segment_size)}
+    );
+    auto lagging = queue.subscribe();
+    for (int i = 0; i < 3; ++i)
+        queue.push(i);
+    ASSERT_EQ(lagging.front(), 0);
+
+    for (int i = 3; i < 16; ++i)
+        queue.push(i);
+    ASSERT_EQ(queue.num_segments(), 2);
+    ASSERT_EQ(dir.num_files(), 2);
+    ASSERT_EQ(queue.head_offset(), 8);
+
+    // Still reads the deleted segment it had started on, then skips ahead
+    ASSERT_EQ(drain(lagging), (std::vector<int>{0, 1, 2, 3, 8, 9, 10, 11, 12, 13, 14, 15}));
+
+    auto sub = queue.subscribe(LogStart::Head);
+    ASSERT_EQ(sub.front(), 8);
+    auto late = queue.subscribe_at(2);
+    ASSERT_EQ(late.offset(), 8);
+}
+
+Test(retention_by_age)
+{
+    LogDirectory dir;
+    LogBroadcastQueue<int> queue(
+        dir.path, {.segment_size = 2 * sizeof(int), .max_age = std::chrono::milliseconds(20)}
+    );
+    for (int i = 0; i < 4; ++i)
+        queue.push(i);
+    ASSERT_EQ(queue.num_segments(), 2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    queue.push(4);
+    ASSERT_EQ(queue.num_segments(), 1);
+    ASSERT_EQ(queue.head_offset(), 4);
+}
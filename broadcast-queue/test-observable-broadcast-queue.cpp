@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "observable-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestObservableBroadcastQueue, test_##name)
+
+Test(notify_pushes_tuple)
+{
+    Observable<int, std::string> events;
+    ObservableBroadcastQueue<int, std::string> queue(events, 8);
+    ASSERT_EQ(events.num_observers(), 1);
+
+    // Discarded, as there are no subscribers yet
+    events.notify(0, "dropped");
+
+    auto sub1 = queue.subscribe();
+    auto sub2 = queue.subscribe();
+    ASSERT_EQ(queue.num_subscribers(), 2);
+    events.notify(1, "one");
+    events.notify(2, std::string("two"));
+
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.front(), std::make_tuple(1, std::string("one")));
+    sub1.pop();
+    ASSERT_EQ(sub1.front(), std::make_tuple(2, std::string("two")));
+    sub1.pop();
+    ASSERT_TRUE(sub1.empty());
+
+    const auto batch = sub2.front_span();
+    ASSERT_EQ(batch.size(), 2);
+    ASSERT_EQ(std::get<1>(batch[1]), "two");
+    sub2.pop_n(batch.size());
+    ASSERT_TRUE(sub2.empty());
+}
+
+Test(reference_arguments_are_copied)
+{
+    Observable<const std::string&, int> events;
+    ObservableBroadcastQueue<const std::string&, int> queue(events, 4);
+    static_assert(std::is_same_v<decltype(queue)::value_type, std::tuple<std::string, int>>);
+
+    auto sub = queue.subscribe();
+    {
+        const std::string name(64, 'x');
+        events.notify(name, 1);
+    }
+    events.notify(std::string("temporary"), 2);
+
+    ASSERT_EQ(std::get<0>(sub.front()), std::string(64, 'x'));
+    sub.pop();
+    ASSERT_EQ(std::get<0>(sub.front()), "temporary");
+    ASSERT_EQ(std::get<1>(sub.front()), 2);
+}
+
+Test(drop_when_full)
+{
+    Observable<int> events;
+    ObservableBroadcastQueue<int> queue(events, 2, ObservableBroadcastQueue<int>::Overflow::drop);
+    auto sub = queue.subscribe();
+    for (int i = 0; i < 5; ++i)
+        events.notify(i);
+
+    ASSERT_EQ(queue.dropped(), 3);
+    ASSERT_EQ(sub.size(), 2);
+    ASSERT_EQ(std::get<0>(sub.front()), 0);
+    sub.pop_n(2);
+
+    events.notify(5);
+    ASSERT_EQ(std::get<0>(sub.front()), 5);
+}
+
+Test(destroyed_in_either_order)
+{
+    auto events = std::make_unique<Observable<int>>();
+    {
+        ObservableBroadcastQueue<int> queue(*events, 4);
+        ASSERT_EQ(events->num_observers(), 1);
+    }
+    ASSERT_EQ(events->num_observers(), 0);
+
+    ObservableBroadcastQueue<int> queue(*events, 4);
+    auto sub = queue.subscribe();
+    events->notify(1);
+    events.reset();
+    ASSERT_EQ(std::get<0>(sub.front()), 1);
+}
+
+Test(cross_thread_batches)
+{
+    constexpr int num_items = 20000;
+    constexpr int num_consumers = 2;
+
+    Observable<int, int> events;
+    ObservableBroadcastQueue<int, int> queue(events, 64);
+
+    std::atomic<int> ready{0};
+    std::vector<long long> sums(num_consumers);
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&, c] {
+            auto sub = queue.subscribe();
+            ready.fetch_add(1);
+
+            int expected = 0;
+            while (expected < num_items) {
+                const auto batch = sub.front_span();
+                for (const auto& [i, square] : batch) {
+                    EXPECT_EQ(i, expected);
+                    EXPECT_EQ(square, (i % 1000) * (i % 1000));
+                    sums[c] += i;
+                    ++expected;
+                }
+                if (batch.empty())
+                    std::this_thread::yield();
+                else
+                    sub.pop_n(batch.size());
+            }
+        });
+    }
+
+    while (ready.load() != num_consumers)
+        std::this_thread::yield();
+
+    for (int i = 0; i < num_items; ++i)
+        events.notify(i, (i % 1000) * (i % 1000));
+
+    for (auto& consumer : consumers)
+        consumer.join();
+    for (long long sum : sums)
+        ASSERT_EQ(sum, (long long)num_items * (num_items - 1) / 2);
+}
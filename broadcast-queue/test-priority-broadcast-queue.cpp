@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "priority-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestPriorityBroadcastQueue, test_##name)
+
+Test(num_subscribers)
+{
+    PriorityBroadcastQueue<int> queue;
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    {
+        auto sub1 = queue.subscribe();
+        auto sub2 = queue.subscribe();
+        ASSERT_EQ(queue.num_subscribers(), 2);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+}
+
+Test(highest_priority_first)
+{
+    PriorityBroadcastQueue<std::string> queue;
+    auto sub = queue.subscribe();
+    queue.push(0, "telemetry 1");
+    queue.push(0, "telemetry 2");
+    queue.push(7, "shutdown");
+    queue.push(3, "config 1");
+    queue.emplace(3, "config 2");
+    ASSERT_EQ(sub.size(), 5);
+
+    const char *expected[] = {"shutdown", "config 1", "config 2", "telemetry 1", "telemetry 2"};
+    const std::size_t priorities[] = {7, 3, 3, 0, 0};
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(sub.front(), expected[i]);
+        ASSERT_EQ(sub.priority(), priorities[i]);
+        sub.pop();
+    }
+    ASSERT_TRUE(sub.empty());
+}
+
+Test(push_between_pops)
+{
+    PriorityBroadcastQueue<int> queue;
+    auto sub = queue.subscribe();
+    queue.push(1, 10);
+    queue.push(1, 11);
+    ASSERT_EQ(sub.front(), 10);
+    sub.pop();
+
+    queue.push(2, 20);
+    ASSERT_EQ(sub.front(), 20);
+    sub.pop();
+    ASSERT_EQ(sub.front(), 11);
+    sub.pop_n(1);
+    ASSERT_TRUE(sub.empty());
+}
+
+Test(every_subscriber_receives)
+{
+    PriorityBroadcastQueue<int, 64> queue;
+    auto sub1 = queue.subscribe();
+    queue.push(0, 1);
+    auto sub2 = queue.subscribe();
+    queue.push(63, 2);
+
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.front(), 2);
+    ASSERT_EQ(sub2.size(), 1);
+    ASSERT_EQ(sub2.front(), 2);
+
+    queue.clear();
+    ASSERT_TRUE(sub1.empty());
+    ASSERT_TRUE(sub2.empty());
+    queue.push(5, 3);
+    ASSERT_EQ(sub1.front(), 3);
+}
+
+Test(priority_out_of_range)
+{
+    PriorityBroadcastQueue<int, 4> queue;
+    auto sub = queue.subscribe();
+    ASSERT_THROW(queue.push(4, 1), std::out_of_range);
+    ASSERT_TRUE(sub.empty());
+}
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "shared-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestSharedBroadcastQueue, test_##name)
+
+namespace {
+
+struct CopyCounter {
+    static inline int copies = 0;
+
+    int value;
+
+    explicit CopyCounter(int value) : value(value) {}
+
+    CopyCounter(const CopyCounter& other) : value(other.value) { ++copies; }
+
+    CopyCounter(CopyCounter&&) = default;
+};
+
+}; // namespace
+
+Test(num_subscribers)
+{
+    SharedBroadcastQueue<int> queue;
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    {
+        queue.subscribe();
+        ASSERT_EQ(queue.num_subscribers(), 0);
+
+        auto sub1 = queue.subscribe();
+        ASSERT_EQ(queue.num_subscribers(), 1);
+        auto sub2 = queue.subscribe();
+        ASSERT_EQ(queue.num_subscribers(), 2);
+
+        {
+            auto sub3 = queue.subscribe();
+            ASSERT_EQ(queue.num_subscribers(), 3);
+        }
+        ASSERT_EQ(queue.num_subscribers(), 2);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+}
+
+Test(queuing)
+{
+    SharedBroadcastQueue<int> queue;
+    queue.push(0);
+    ASSERT_EQ(queue.size(), 0);
+
+    auto sub1 = queue.subscribe();
+    ASSERT_TRUE(sub1.empty());
+    ASSERT_EQ(sub1.size(), 0);
+
+    queue.push(1);
+    queue.push(2);
+    ASSERT_EQ(sub1.size(), 2);
+    ASSERT_EQ(sub1.back(), 2);
+    ASSERT_EQ(sub1.front(), 1);
+
+    auto sub2 = queue.subscribe();
+    queue.push(3);
+    ASSERT_EQ(sub1.size(), 3);
+    ASSERT_EQ(sub1.back(), 3);
+    ASSERT_EQ(sub1.front(), 1);
+    ASSERT_EQ(sub2.size(), 1);
+    ASSERT_EQ(sub2.back(), 3);
+    ASSERT_EQ(sub2.front(), 3);
+    ASSERT_EQ(queue.size(), 3);
+}
+
+Test(popping)
+{
+    SharedBroadcastQueue<int> queue;
+
+    auto sub1 = queue.subscribe();
+    auto sub2 = queue.subscribe();
+
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);
+    queue.push(4);
+
+    ASSERT_EQ(sub1.front(), 1);
+    sub1.pop();
+    ASSERT_EQ(sub1.front(), 2);
+    sub1.pop();
+    sub1.pop();
+    ASSERT_EQ(sub1.front(), 4);
+    ASSERT_EQ(sub1.back(), 4);
+    sub1.pop();
+    ASSERT_TRUE(sub1.empty());
+
+    // sub2 has not popped anything so every item is still held
+    ASSERT_EQ(queue.size(), 4);
+    ASSERT_EQ(sub2.size(), 4);
+    ASSERT_EQ(sub2.front(), 1);
+    sub2.pop();
+    ASSERT_EQ(queue.size(), 3);
+    ASSERT_EQ(sub2.front(), 2);
+    ASSERT_EQ(sub2.back(), 4);
+}
+
+Test(clear)
+{
+    SharedBroadcastQueue<int> queue;
+
+    auto sub1 = queue.subscribe();
+    queue.push(1);
+    queue.push(2);
+
+    auto sub2 = queue.subscribe();
+    queue.push(3);
+
+    queue.clear();
+    ASSERT_TRUE(sub1.empty());
+    ASSERT_TRUE(sub2.empty());
+    ASSERT_EQ(queue.size(), 0);
+
+    queue.push(4);
+    ASSERT_EQ(sub1.front(), 4);
+    ASSERT_EQ(sub2.front(), 4);
+}
+
+Test(unsubscribe_releases_items)
+{
+    SharedBroadcastQueue<std::string> queue;
+    auto sub1 = queue.subscribe();
+    {
+        auto sub2 = queue.subscribe();
+        queue.push("a");
+        queue.push("b");
+        sub1.pop();
+        sub1.pop();
+        ASSERT_EQ(queue.size(), 2);
+    }
+    ASSERT_EQ(queue.size(), 0);
+}
+
+Test(ring_grows_and_wraps)
+{
+    SharedBroadcastQueue<int> queue;
+    auto fast = queue.subscribe();
+    auto slow = queue.subscribe();
+
+    for (int i = 0; i < 1000; ++i) {
+        queue.push(i);
+        ASSERT_EQ(fast.front(), i);
+        fast.pop();
+        if (i % 2 == 0) {
+            ASSERT_EQ(slow.front(), i / 2);
+            slow.pop();
+        }
+    }
+
+    ASSERT_EQ(slow.size(), 500);
+    ASSERT_EQ(queue.size(), 500);
+    ASSERT_GE(queue.capacity(), 500);
+    for (int i = 500; i < 1000; ++i) {
+        ASSERT_EQ(slow.front(), i);
+        slow.pop();
+    }
+    ASSERT_EQ(queue.size(), 0);
+}
+
+Test(item_stored_once)
+{
+    SharedBroadcastQueue<CopyCounter> queue;
+    auto sub1 = queue.subscribe();
+    auto sub2 = queue.subscribe();
+    auto sub3 = queue.subscribe();
+
+    CopyCounter::copies = 0;
+    const CopyCounter value(7);
+    queue.push(value);
+    ASSERT_EQ(CopyCounter::copies, 1);
+
+    queue.push(CopyCounter(8));
+    ASSERT_EQ(CopyCounter::copies, 1);
+
+    ASSERT_EQ(sub1.front().value, 7);
+    ASSERT_EQ(sub2.front().value, 7);
+    ASSERT_EQ(sub3.back().value, 8);
+}
+
+Test(front_span)
+{
+    SharedBroadcastQueue<int> queue;
+    auto sub = queue.subscribe();
+    ASSERT_TRUE(sub.front_span().empty());
+
+    for (int i = 0; i < 10; ++i)
+        queue.push(i);
+
+    auto items = sub.front_span();
+    ASSERT_EQ(items.size(), 10);
+    ASSERT_EQ(&items.front(), &sub.front());
+    ASSERT_EQ(items[9], 9);
+
+    sub.pop_n(4);
+    ASSERT_EQ(sub.size(), 6);
+    ASSERT_EQ(sub.front(), 4);
+    ASSERT_EQ(queue.size(), 6);
+}
+
+Test(front_span_wraps)
+{
+    SharedBroadcastQueue<int> queue;
+    auto sub = queue.subscribe();
+
+    // Move the cursor near the end of the ring so the next items wrap around
+    for (int i = 0; i < 12; ++i)
+        queue.push(i);
+    sub.pop_n(12);
+    ASSERT_EQ(queue.capacity(), 16);
+
+    for (int i = 0; i < 8; ++i)
+        queue.push(i);
+
+    std::vector<int> drained;
+    int spans = 0;
+    for (auto items = sub.front_span(); !items.empty(); items = sub.front_span()) {
+        drained.insert(drained.end(), items.begin(), items.end());
+        sub.pop_n(items.size());
+        ++spans;
+    }
+    ASSERT_EQ(spans, 2);
+    ASSERT_EQ(drained, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+    ASSERT_EQ(queue.size(), 0);
+}
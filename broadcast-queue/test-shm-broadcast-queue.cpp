@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shm-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestShmBroadcastQueue, test_##name)
+
+namespace {
+
+struct Item {
+    std::uint64_t seq;
+    std::uint64_t check;
+};
+
+// A unique segment name for each test, unlinked afterwards
+class SegmentName {
+public:
+    SegmentName() :
+        name("/test-shm-broadcast-queue-" + std::to_string(::getpid()) + "-"
+             + ::testing::UnitTest::GetInstance()->current_test_info()->name())
+    {
+        ShmBroadcastQueue<Item>::unlink(name);
+    }
+
+    ~SegmentName() { ShmBroadcastQueue<Item>::unlink(name); }
+
+    const std::string name;
+};
+
+// Runs function in a child process and returns its exit status
+template <class F> int run_in_child(F&& function)
+{
+    const pid_t pid = ::fork();
+    if (pid == 0)
+        ::_exit(function());
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+}; // namespace
+
+Test(queuing)
+{
+    SegmentName segment;
+    auto producer = ShmBroadcastQueue<Item>::create(segment.name, 8, 4);
+    auto consumer = ShmBroadcastQueue<Item>::open(segment.name);
+    ASSERT_EQ(consumer.capacity(), 8);
+    ASSERT_EQ(consumer.max_subscribers(), 4);
+
+    producer.push({0, 0});
+    auto sub = consumer.subscribe();
+    ASSERT_EQ(producer.num_subscribers(), 1);
+    ASSERT_TRUE(sub.empty());
+
+    producer.push({1, 10});
+    producer.push({2, 20});
+    ASSERT_EQ(sub.size(), 2);
+    ASSERT_EQ(sub.front().seq, 1);
+    sub.pop();
+    ASSERT_EQ(sub.front().check, 20);
+    sub.pop();
+    ASSERT_TRUE(sub.empty());
+}
+
+Test(front_span)
+{
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 4, 1);
+    auto sub = queue.subscribe();
+    for (std::uint64_t i = 0; i < 3; ++i)
+        queue.push({i, 0});
+    sub.pop_n(3);
+    for (std::uint64_t i = 3; i < 7; ++i)
+        queue.push({i, 0});
+
+    auto items = sub.front_span();
+    ASSERT_EQ(items.size(), 1);
+    ASSERT_EQ(items[0].seq, 3);
+    sub.pop_n(items.size());
+    items = sub.front_span();
+    ASSERT_EQ(items.size(), 3);
+    ASSERT_EQ(items[2].seq, 6);
+}
+
+Test(full)
+{
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 4, 2);
+    for (std::uint64_t i = 0; i < 10; ++i)
+        ASSERT_TRUE(queue.try_push({i, 0}));
+
+    auto sub = queue.subscribe();
+    for (std::uint64_t i = 0; i < 4; ++i)
+        ASSERT_TRUE(queue.try_push({i, 0}));
+    ASSERT_FALSE(queue.try_push({4, 0}));
+    sub.pop();
+    ASSERT_TRUE(queue.try_push({4, 0}));
+}
+
+Test(too_many_subscribers)
+{
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 4, 1);
+    {
+        auto sub = queue.subscribe();
+        ASSERT_THROW(queue.subscribe(), std::length_error);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    auto sub = queue.subscribe();
+}
+
+Test(open_missing)
+{
+    SegmentName segment;
+    ASSERT_THROW(ShmBroadcastQueue<Item>::open(segment.name), std::system_error);
+}
+
+Test(wait_for_timeout)
+{
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 4, 1);
+    auto sub = queue.subscribe();
+    ASSERT_FALSE(sub.wait_for(std::chrono::milliseconds(10)));
+    queue.push({0, 0});
+    ASSERT_TRUE(sub.wait_for(std::chrono::milliseconds(10)));
+}
+
+Test(reclaim_dead_subscribers)
+{
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 4, 2);
+    const int status = run_in_child([&] {
+        auto consumer = ShmBroadcastQueue<Item>::open(segment.name);
+        new auto(consumer.subscribe()); // never unsubscribes
+        return 0;
+    });
+    ASSERT_EQ(status, 0);
+    ASSERT_EQ(queue.num_subscribers(), 1);
+    ASSERT_EQ(queue.reclaim_dead_subscribers(), 1);
+    ASSERT_EQ(queue.num_subscribers(), 0);
+
+    // The freed cursor is reused, and not reclaimed from its new subscriber
+    auto sub = queue.subscribe();
+    ASSERT_EQ(queue.reclaim_dead_subscribers(), 0);
+    ASSERT_EQ(queue.num_subscribers(), 1);
+}
+
+Test(concurrent_reclaims_free_each_cursor_once)
+{
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 4, 4);
+    const int status = run_in_child([&] {
+        auto consumer = ShmBroadcastQueue<Item>::open(segment.name);
+        for (int i = 0; i < 3; ++i)
+            new auto(consumer.subscribe());
+        return 0;
+    });
+    ASSERT_EQ(status, 0);
+    ASSERT_EQ(queue.num_subscribers(), 3);
+
+    std::atomic<std::size_t> reclaimed{0};
+    std::vector<std::thread> reclaimers;
+    for (int i = 0; i < 4; ++i)
+        reclaimers.emplace_back([&] { reclaimed += queue.reclaim_dead_subscribers(); });
+    for (auto& reclaimer : reclaimers)
+        reclaimer.join();
+    ASSERT_EQ(reclaimed.load(), 3);
+    ASSERT_EQ(queue.num_subscribers(), 0);
+}
+
+Test(across_processes)
+{
+    constexpr std::uint64_t num_items = 100000;
+    constexpr int num_children = 3;
+
+    SegmentName segment;
+    auto queue = ShmBroadcastQueue<Item>::create(segment.name, 64, num_children);
+
+    pid_t children[num_children];
+    for (auto& child : children) {
+        child = ::fork();
+        if (child != 0)
+            continue;
+
+        // Checks it receives every item in order, waiting when empty
+        auto consumer = ShmBroadcastQueue<Item>::open(segment.name);
+        auto sub = consumer.subscribe();
+        std::uint64_t expected = 0;
+        while (expected < num_items) {
+            sub.wait();
+            const auto items = sub.front_span();
+            for (const Item& item : items) {
+                if (item.seq != expected || item.check != expected * 3)
+                    ::_exit(1);
+                ++expected;
+            }
+            sub.pop_n(items.size());
+        }
+        ::_exit(0);
+    }
+
+    while (queue.num_subscribers() != num_children)
+        std::this_thread::yield();
+    for (std::uint64_t i = 0; i < num_items; ++i)
+        queue.push({i, i * 3});
+
+    for (const pid_t child : children) {
+        int status = 0;
+        ::waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(WEXITSTATUS(status), 0);
+    }
+}
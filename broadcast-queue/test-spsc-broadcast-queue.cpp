@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "spsc-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestSpscBroadcastQueue, test_##name)
+
+Test(num_subscribers)
+{
+    SpscBroadcastQueue<int> queue(4);
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    {
+        auto sub = queue.subscribe();
+        ASSERT_EQ(queue.num_subscribers(), 1);
+        ASSERT_THROW(queue.subscribe(), std::length_error);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    auto sub = queue.subscribe();
+    ASSERT_EQ(queue.num_subscribers(), 1);
+}
+
+Test(capacity_rounded_to_power_of_two)
+{
+    ASSERT_EQ(SpscBroadcastQueue<int>(1).capacity(), 1);
+    ASSERT_EQ(SpscBroadcastQueue<int>(5).capacity(), 8);
+    ASSERT_EQ(SpscBroadcastQueue<int>(64).capacity(), 64);
+}
+
+Test(queuing)
+{
+    SpscBroadcastQueue<int> queue(4);
+    ASSERT_TRUE(queue.try_push(0)); // dropped
+
+    auto sub = queue.subscribe();
+    ASSERT_TRUE(sub.empty());
+    ASSERT_EQ(sub.size(), 0);
+
+    queue.push(1);
+    queue.push(2);
+    ASSERT_EQ(sub.size(), 2);
+    ASSERT_EQ(sub.front(), 1);
+    sub.pop();
+    ASSERT_EQ(sub.front(), 2);
+
+    int value = 0;
+    ASSERT_TRUE(sub.try_pop(value));
+    ASSERT_EQ(value, 2);
+    ASSERT_FALSE(sub.try_pop(value));
+    ASSERT_TRUE(sub.empty());
+}
+
+Test(full_queue)
+{
+    SpscBroadcastQueue<int> queue(2);
+    auto sub = queue.subscribe();
+    ASSERT_TRUE(queue.try_push(1));
+    ASSERT_TRUE(queue.try_push(2));
+    ASSERT_FALSE(queue.try_push(3));
+
+    sub.pop();
+    ASSERT_TRUE(queue.try_push(3));
+    ASSERT_EQ(sub.front(), 2);
+    sub.pop();
+    ASSERT_EQ(sub.front(), 3);
+}
+
+Test(front_span_wraps)
+{
+    SpscBroadcastQueue<int> queue(4);
+    auto sub = queue.subscribe();
+    for (int i = 0; i < 3; ++i)
+        queue.push(i);
+    sub.pop_n(3);
+    for (int i = 3; i < 7; ++i)
+        queue.push(i);
+
+    // [3] at the end of the ring, [4, 5, 6] at the start
+    auto span = sub.front_span();
+    ASSERT_EQ(span.size(), 1);
+    ASSERT_EQ(span[0], 3);
+    sub.pop_n(span.size());
+
+    span = sub.front_span();
+    ASSERT_EQ(span.size(), 3);
+    ASSERT_EQ(span[0], 4);
+    ASSERT_EQ(span[2], 6);
+    sub.pop_n(span.size());
+    ASSERT_TRUE(sub.front_span().empty());
+}
+
+Test(new_subscriber_starts_empty)
+{
+    SpscBroadcastQueue<std::shared_ptr<int>> queue(4);
+    auto value = std::make_shared<int>(1);
+    {
+        auto sub = queue.subscribe();
+        queue.push(value);
+        queue.push(value);
+        ASSERT_EQ(value.use_count(), 3);
+    }
+    // Unconsumed items are destroyed with the subscriber
+    ASSERT_EQ(value.use_count(), 1);
+
+    queue.push(value);
+    ASSERT_EQ(value.use_count(), 1);
+
+    auto sub = queue.subscribe();
+    ASSERT_TRUE(sub.empty());
+    queue.push(value);
+    ASSERT_EQ(*sub.front(), 1);
+}
+
+Test(destroys_remaining_items)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        SpscBroadcastQueue<std::shared_ptr<int>> queue(4);
+        auto sub = queue.subscribe();
+        queue.push(value);
+        sub.pop();
+        queue.push(value);
+        ASSERT_EQ(value.use_count(), 2);
+    }
+    ASSERT_EQ(value.use_count(), 1);
+}
+
+Test(resubscribe_while_unsubscribing)
+{
+    constexpr int num_rounds = 2000;
+    auto value = std::make_shared<int>(1);
+    {
+        SpscBroadcastQueue<std::shared_ptr<int>> queue(8);
+        std::atomic<bool> done{false};
+
+        std::thread producer([&] {
+            while (!done.load())
+                queue.try_push(value);
+        });
+
+        // Each subscriber is destroyed on one thread while the other may be
+        // subscribing
+        auto subscribe_and_leave = [&] {
+            for (int i = 0; i < num_rounds; ++i) {
+                try {
+                    auto sub = queue.subscribe();
+                    if (!sub.empty())
+                        sub.pop();
+                } catch (const std::length_error&) {
+                    std::this_thread::yield();
+                }
+            }
+        };
+        std::thread first(subscribe_and_leave);
+        std::thread second(subscribe_and_leave);
+        first.join();
+        second.join();
+        done.store(true);
+        producer.join();
+
+        ASSERT_EQ(queue.num_subscribers(), 0);
+    }
+    ASSERT_EQ(value.use_count(), 1);
+}
+
+Test(stress)
+{
+    constexpr int num_items = 200000;
+    SpscBroadcastQueue<int> queue(64);
+    std::atomic<bool> ready{false};
+
+    std::thread consumer([&] {
+        auto sub = queue.subscribe();
+        ready.store(true);
+        for (int expected = 0; expected < num_items;) {
+            const auto items = sub.front_span();
+            if (items.empty()) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (int item : items)
+                EXPECT_EQ(item, expected++);
+            sub.pop_n(items.size());
+        }
+    });
+
+    while (!ready.load())
+        std::this_thread::yield();
+    for (int i = 0; i < num_items; ++i)
+        queue.push(i);
+
+    consumer.join();
+    EXPECT_EQ(queue.num_subscribers(), 0);
+}
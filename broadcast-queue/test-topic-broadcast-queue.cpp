@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "topic-broadcast-queue.hpp"
+
+using namespace recap::app::broadcast_queue;
+
+#define Test(name) TEST(TestTopicBroadcastQueue, test_##name)
+
+namespace {
+
+template <class Subscriber> std::vector<int> drain(Subscriber& sub)
+{
+    std::vector<int> items;
+    while (!sub.empty()) {
+        items.push_back(sub.front());
+        sub.pop();
+    }
+    return items;
+}
+
+}; // namespace
+
+Test(num_subscribers)
+{
+    TopicBroadcastQueue<std::string, int> queue;
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    {
+        auto sub1 = queue.subscribe({"a", "b"});
+        auto sub2 = queue.subscribe({"b"});
+        auto sub3 = queue.subscribe_all();
+        ASSERT_EQ(queue.num_subscribers(), 3);
+        ASSERT_EQ(queue.num_subscribers("a"), 2);
+        ASSERT_EQ(queue.num_subscribers("b"), 3);
+        ASSERT_EQ(queue.num_subscribers("c"), 1);
+    }
+    ASSERT_EQ(queue.num_subscribers(), 0);
+    ASSERT_EQ(queue.num_subscribers("b"), 0);
+}
+
+Test(routing)
+{
+    TopicBroadcastQueue<std::string, int> queue;
+    auto a = queue.subscribe({"a"});
+    auto ab = queue.subscribe({"a", "b", "a"});
+    auto all = queue.subscribe_all();
+
+    queue.push("a", 1);
+    queue.push("b", 2);
+    queue.push("c", 3);
+    queue.emplace("a", 4);
+
+    ASSERT_EQ(drain(a), (std::vector<int>{1, 4}));
+    ASSERT_EQ(drain(ab), (std::vector<int>{1, 2, 4}));
+    ASSERT_EQ(drain(all), (std::vector<int>{1, 2, 3, 4}));
+}
+
+Test(push_without_subscribers)
+{
+    TopicBroadcastQueue<int, std::string> queue;
+    queue.push(1, "dropped");
+
+    auto sub = queue.subscribe({2});
+    queue.push(1, "dropped");
+    queue.push(2, "kept");
+    ASSERT_EQ(sub.size(), 1);
+    ASSERT_EQ(sub.front(), "kept");
+}
+
+Test(unsubscribe)
+{
+    TopicBroadcastQueue<int, int> queue;
+    auto sub1 = queue.subscribe({1, 2});
+    {
+        auto sub2 = queue.subscribe({1});
+        auto sub3 = queue.subscribe_all();
+        queue.push(1, 10);
+        ASSERT_EQ(sub2.size(), 1);
+        ASSERT_EQ(sub3.size(), 1);
+    }
+    queue.push(1, 11);
+    queue.push(2, 20);
+    ASSERT_EQ(drain(sub1), (std::vector<int>{10, 11, 20}));
+    ASSERT_EQ(queue.num_subscribers(1), 1);
+}
+
+Test(clear)
+{
+    TopicBroadcastQueue<int, int> queue;
+    auto sub1 = queue.subscribe({1});
+    auto sub2 = queue.subscribe_all();
+    queue.push(1, 1);
+    queue.push(2, 2);
+    queue.clear();
+    ASSERT_TRUE(sub1.empty());
+    ASSERT_TRUE(sub2.empty());
+}
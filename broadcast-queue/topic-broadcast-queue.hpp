@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace recap::app::broadcast_queue {
+
+template <class Key, class T, class Hash, class KeyEqual, class Container>
+class TopicBroadcastQueueSubscriber;
+
+/**
+ * A BroadcastQueue whose items are pushed under a key (or topic), and only
+ * queued for the subscribers to that key. Subscribers are found through a
+ * hash index, so the cost of a push depends on the number of subscribers
+ * receiving the item rather than the total number of subscribers.
+ *
+ *   TopicBroadcastQueue<std::string, Message> queue;
+ *   auto status = queue.subscribe({"status"});
+ *   auto all = queue.subscribe_all();
+ *   queue.push("status", message); // queued for status and all
+ *   queue.push("debug", message);  // queued for all only
+ *
+ * NOT THREAD SAFE.
+ */
+template <
+    class Key,
+    class T,
+    class Hash = std::hash<Key>,
+    class KeyEqual = std::equal_to<Key>,
+    class Container = std::deque<T>>
+class TopicBroadcastQueue {
+public:
+    using key_type = Key;
+    using value_type = T;
+    using container_type = Container;
+    using queue_type = std::queue<T, container_type>;
+    using size_type = typename queue_type::size_type;
+    using subscriber_type = TopicBroadcastQueueSubscriber<Key, T, Hash, KeyEqual, Container>;
+
+    TopicBroadcastQueue() = default;
+
+    TopicBroadcastQueue(const TopicBroadcastQueue&) = delete;
+    TopicBroadcastQueue& operator=(const TopicBroadcastQueue&) = delete;
+    TopicBroadcastQueue(TopicBroadcastQueue&&) = delete;
+    TopicBroadcastQueue& operator=(TopicBroadcastQueue&&) = delete;
+
+    // Receives the items pushed with any of keys
+    subscriber_type subscribe(std::vector<Key> keys)
+    {
+        auto handle = observers.emplace(observers.end(), std::make_unique<Subscription>());
+        Subscription& subscription = **handle;
+        for (const Key& key : keys) {
+            auto& targets = index[key];
+            if (std::find(targets.begin(), targets.end(), &subscription.queue) == targets.end())
+                targets.push_back(&subscription.queue);
+        }
+        subscription.keys = std::move(keys);
+        return subscriber_type(*this, handle);
+    }
+
+    subscriber_type subscribe(std::initializer_list<Key> keys)
+    {
+        return subscribe(std::vector<Key>(keys));
+    }
+
+    // Receives every item, whatever its key
+    subscriber_type subscribe_all()
+    {
+        auto handle = observers.emplace(observers.end(), std::make_unique<Subscription>());
+        (*handle)->all = true;
+        wildcards.push_back(&(*handle)->queue);
+        return subscriber_type(*this, handle);
+    }
+
+    void clear()
+    {
+        for (const auto& observer : observers)
+            queue_type().swap(observer->queue);
+    }
+
+    void push(const Key& key, const T& value) { emplace(key, value); }
+
+    void push(const Key& key, T&& value) { emplace(key, std::move(value)); }
+
+    // As with BroadcastQueue, the item is constructed in the last receiving
+    // queue and copied into the others.
+    template <class... Args> void emplace(const Key& key, Args&&...args)
+    {
+        const auto found = index.find(key);
+        const std::vector<queue_type *> *keyed = found == index.end() ? nullptr : &found->second;
+
+        queue_type *last;
+        if (!wildcards.empty())
+            last = wildcards.back();
+        else if (keyed)
+            last = keyed->back();
+        else
+            return;
+
+        last->emplace(std::forward<Args>(args)...);
+        const T& item = last->back();
+        if (keyed) {
+            for (queue_type *queue : *keyed) {
+                if (queue != last)
+                    queue->push(item);
+            }
+        }
+        for (queue_type *queue : wildcards) {
+            if (queue != last)
+                queue->push(item);
+        }
+    }
+
+    size_type num_subscribers() const { return observers.size(); }
+
+    // Number of subscribers that would receive an item pushed with key
+    size_type num_subscribers(const Key& key) const
+    {
+        const auto found = index.find(key);
+        return wildcards.size() + (found == index.end() ? 0 : found->second.size());
+    }
+
+private:
+    friend subscriber_type;
+
+    struct Subscription {
+        queue_type queue;
+        std::vector<Key> keys;
+        bool all = false;
+    };
+
+    using observer_list_t = std::list<std::unique_ptr<Subscription>>;
+    using handle_t = typename observer_list_t::iterator;
+
+    observer_list_t observers;
+
+    // The queues subscribed to each key. Keys without subscribers are removed.
+    std::unordered_map<Key, std::vector<queue_type *>, Hash, KeyEqual> index;
+    std::vector<queue_type *> wildcards;
+
+    static void remove_target(std::vector<queue_type *>& targets, const queue_type *queue)
+    {
+        targets.erase(std::remove(targets.begin(), targets.end(), queue), targets.end());
+    }
+
+    void unsubscribe(handle_t handle)
+    {
+        const Subscription& subscription = **handle;
+        if (subscription.all)
+            remove_target(wildcards, &subscription.queue);
+        for (const Key& key : subscription.keys) {
+            const auto found = index.find(key);
+            if (found == index.end())
+                continue;
+            remove_target(found->second, &subscription.queue);
+            if (found->second.empty())
+                index.erase(found);
+        }
+        observers.erase(handle);
+    }
+};
+
+/**
+ * Provides the same element access and capacity interfaces as std::queue<T>
+ */
+template <class Key, class T, class Hash, class KeyEqual, class Container>
+class TopicBroadcastQueueSubscriber {
+public:
+    using queue_type = TopicBroadcastQueue<Key, T, Hash, KeyEqual, Container>;
+    using value_type = typename queue_type::queue_type::value_type;
+    using size_type = typename queue_type::queue_type::size_type;
+    using reference = typename queue_type::queue_type::reference;
+    using const_reference = typename queue_type::queue_type::const_reference;
+
+    TopicBroadcastQueueSubscriber(const TopicBroadcastQueueSubscriber&) = delete;
+    TopicBroadcastQueueSubscriber& operator=(const TopicBroadcastQueueSubscriber&) = delete;
+    TopicBroadcastQueueSubscriber(TopicBroadcastQueueSubscriber&&) = delete;
+    TopicBroadcastQueueSubscriber& operator=(TopicBroadcastQueueSubscriber&&) = delete;
+
+    ~TopicBroadcastQueueSubscriber() { controller.unsubscribe(handle); }
+
+    bool empty() const { return (*handle)->queue.empty(); }
+
+    const_reference back() const { return (*handle)->queue.back(); }
+
+    reference back() { return (*handle)->queue.back(); }
+
+    const_reference front() const { return (*handle)->queue.front(); }
+
+    reference front() { return (*handle)->queue.front(); }
+
+    void pop() { (*handle)->queue.pop(); }
+
+    // Pops the first n items. n must not be greater than size().
+    void pop_n(size_type n)
+    {
+        for (; n > 0; --n)
+            (*handle)->queue.pop();
+    }
+
+    size_type size() const { return (*handle)->queue.size(); }
+
+private:
+    friend queue_type;
+
+    queue_type& controller;
+    typename queue_type::handle_t handle;
+
+    TopicBroadcastQueueSubscriber(queue_type& controller, typename queue_type::handle_t handle) :
+        controller(controller), handle(handle)
+    {}
+};
+
+}; // namespace recap::app::broadcast_queue
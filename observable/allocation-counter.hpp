@@ -0,0 +1,39 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_ALLOCATION_COUNTER_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_ALLOCATION_COUNTER_HPP_INCLUDE
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Replaces the global operator new and operator delete to count heap
+ * allocations, for tests and benchmarks that check what allocates. Include
+ * it in exactly one translation unit of the program.
+ *
+ *   const std::size_t before = allocations;
+ *   do_something();
+ *   EXPECT_EQ(allocations, before);
+ */
+inline std::size_t allocations = 0;
+
+// The replacements are a matching pair, but once they are inlined GCC sees
+// free() called on memory from operator new
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(std::size_t size)
+{
+    ++allocations;
+    if (void *ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+#pragma GCC diagnostic pop
+
+#endif // HARRYMANDER_CPP_SNIPPETS_ALLOCATION_COUNTER_HPP_INCLUDE
@@ -0,0 +1,283 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_ASYNC_OBSERVABLE_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_ASYNC_OBSERVABLE_HPP_INCLUDE
+
+#include "concurrent-observable.hpp"
+#include "executor.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+enum class DispatchOrder {
+    // An observer is called with one notification at a time, in the order
+    // they were notified
+    Sequential,
+    // Notifications to an observer may be delivered concurrently and out of
+    // order, e.g. by several threads of a ThreadPool
+    Unordered,
+};
+
+// What happens when a notification arrives for an observer that already has
+// max_pending notifications waiting
+enum class DispatchOverflow {
+    DropOldest,
+    DropNewest,
+};
+
+struct DispatchOptions {
+    DispatchOrder order = DispatchOrder::Sequential;
+    std::size_t max_pending = 0; // 0 for no limit
+    DispatchOverflow overflow = DispatchOverflow::DropOldest;
+};
+
+/**
+ * An Observable that calls each observer on an Executor chosen when
+ * subscribing, rather than on the thread calling notify(). notify() copies the
+ * values once, queues them for each observer and returns, so its cost does not
+ * depend on how long the observers take.
+ *
+ * Observer functions are called with const references to the copied values,
+ * so Ts must be copyable value types (or const references to them).
+ *
+ * notify(), subscribe() and destroying Observers are thread-safe. Once an
+ * Observer's destructor returns its function will not be called again; if the
+ * function is running on another thread at the time, the destructor waits for
+ * it to return. The Observer's executor must outlive it.
+ *
+ * An exception thrown by an observer function propagates to the executor
+ * (with an InlineExecutor, out of notify()) and does not stop the observer
+ * from receiving later notifications.
+ */
+template <typename... Ts> class AsyncObservable {
+public:
+    using Function = std::function<void(Ts...)>;
+
+private:
+    using Values = std::tuple<std::decay_t<Ts>...>;
+    using ValuesPtr = std::shared_ptr<const Values>;
+
+    class Subscription : public std::enable_shared_from_this<Subscription> {
+    public:
+        Subscription(Executor& executor, Function function, DispatchOptions options) :
+            m_executor(executor), m_function(std::move(function)), m_options(options)
+        {}
+
+        void post(const ValuesPtr& values)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_active) {
+                    return;
+                }
+                if (m_options.max_pending != 0 && m_queue.size() >= m_options.max_pending) {
+                    ++m_dropped;
+                    if (m_options.overflow == DispatchOverflow::DropNewest) {
+                        return;
+                    }
+                    m_queue.pop_front();
+                }
+                m_queue.push_back(values);
+
+                if (m_options.order == DispatchOrder::Sequential) {
+                    if (m_scheduled) {
+                        return;
+                    }
+                    m_scheduled = true;
+                }
+            }
+
+            // Outside the lock, as an InlineExecutor runs the task immediately
+            if (m_options.order == DispatchOrder::Sequential) {
+                m_executor.execute([self = this->shared_from_this()] { self->drain(); });
+            } else {
+                m_executor.execute([self = this->shared_from_this()] { self->run_one(); });
+            }
+        }
+
+        // Stops further calls and waits for calls in progress on other threads
+        void cancel()
+        {
+            std::unique_lock lock(m_mutex);
+            m_active = false;
+            m_queue.clear();
+            const std::size_t own_calls = t_running == this ? 1 : 0;
+            m_idle.wait(lock, [&] { return m_running == own_calls; });
+        }
+
+        [[nodiscard]] std::size_t pending() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_queue.size();
+        }
+
+        [[nodiscard]] std::size_t dropped() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_dropped;
+        }
+
+    private:
+        static inline thread_local const Subscription *t_running = nullptr;
+
+        Executor& m_executor;
+        const Function m_function;
+        const DispatchOptions m_options;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_idle;
+        std::deque<ValuesPtr> m_queue;
+        std::size_t m_dropped = 0;
+        std::size_t m_running = 0;
+        bool m_scheduled = false;
+        bool m_active = true;
+
+        // Sequential: one task at a time calls the function until the queue is
+        // empty.
+        void drain()
+        {
+            for (;;) {
+                ValuesPtr values;
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (!m_active || m_queue.empty()) {
+                        m_scheduled = false;
+                        return;
+                    }
+                    values = take();
+                }
+                try {
+                    call(*values);
+                } catch (...) {
+                    // Hands the rest of the queue to a new task before the
+                    // exception leaves this one
+                    bool reschedule = false;
+                    {
+                        std::lock_guard lock(m_mutex);
+                        reschedule = m_active && !m_queue.empty();
+                        m_scheduled = reschedule;
+                    }
+                    if (reschedule) {
+                        m_executor.execute([self = this->shared_from_this()] { self->drain(); });
+                    }
+                    throw;
+                }
+            }
+        }
+
+        // Unordered: one task per notification
+        void run_one()
+        {
+            ValuesPtr values;
+            {
+                std::lock_guard lock(m_mutex);
+                // The notification may have been dropped since the task was
+                // queued
+                if (!m_active || m_queue.empty()) {
+                    return;
+                }
+                values = take();
+            }
+            call(*values);
+        }
+
+        ValuesPtr take()
+        {
+            ValuesPtr values = std::move(m_queue.front());
+            m_queue.pop_front();
+            ++m_running;
+            return values;
+        }
+
+        // Ends the call started by take(), even if the function throws
+        class Running {
+        public:
+            explicit Running(Subscription& subscription) :
+                m_subscription(subscription), m_outer(std::exchange(t_running, &subscription))
+            {}
+
+            ~Running()
+            {
+                t_running = m_outer;
+                {
+                    std::lock_guard lock(m_subscription.m_mutex);
+                    --m_subscription.m_running;
+                }
+                m_subscription.m_idle.notify_all();
+            }
+
+            Running(const Running&) = delete;
+            Running& operator=(const Running&) = delete;
+
+        private:
+            Subscription& m_subscription;
+            const Subscription *m_outer;
+        };
+
+        void call(const Values& values)
+        {
+            Running running(*this);
+            std::apply(m_function, values);
+        }
+    };
+
+    using Dispatcher = ConcurrentObservable<const ValuesPtr&>;
+
+public:
+    class Observer {
+    private:
+        std::shared_ptr<Subscription> m_subscription;
+        typename Dispatcher::Observer m_observer;
+
+        Observer(Dispatcher& dispatcher, std::shared_ptr<Subscription> subscription) :
+            m_subscription(std::move(subscription)),
+            m_observer(dispatcher.subscribe([subscription = m_subscription](const ValuesPtr& values) {
+                subscription->post(values);
+            }))
+        {}
+
+        friend class AsyncObservable;
+
+    public:
+        ~Observer() { m_subscription->cancel(); }
+
+        // Notifications queued for this observer that have not started yet
+        [[nodiscard]] std::size_t pending() const { return m_subscription->pending(); }
+
+        // Notifications discarded because max_pending was reached
+        [[nodiscard]] std::size_t dropped() const { return m_subscription->dropped(); }
+
+        Observer(const Observer&) = delete;
+        Observer& operator=(const Observer&) = delete;
+        Observer(Observer&&) = delete;
+        Observer& operator=(Observer&&) = delete;
+    };
+
+    [[nodiscard]] std::size_t num_observers() const { return m_dispatcher.num_observers(); }
+
+    template <typename... Args> void notify(Args&&...args) const
+    {
+        m_dispatcher.notify(std::make_shared<const Values>(std::forward<Args>(args)...));
+    }
+
+    [[nodiscard]] Observer
+    subscribe(Executor& executor, Function function, DispatchOptions options = {})
+    {
+        return Observer(
+            m_dispatcher,
+            std::make_shared<Subscription>(executor, std::move(function), options)
+        );
+    }
+
+private:
+    Dispatcher m_dispatcher;
+};
+
+template <typename... Ts> using AsyncObserver = typename AsyncObservable<Ts...>::Observer;
+
+#endif // HARRYMANDER_CPP_SNIPPETS_ASYNC_OBSERVABLE_HPP_INCLUDE
@@ -0,0 +1,255 @@
+#include "allocation-counter.hpp"
+#include "concurrent-observable.hpp"
+#include "forwarding-observable.hpp"
+#include "observable.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The original std::list<std::function> based Observable, kept as a baseline
+template <typename... Ts> class ListObservable {
+public:
+    using Function = std::function<void(Ts...)>;
+    using ObserverList = std::list<Function>;
+
+    ListObservable() : m_observers(std::make_shared<ObserverList>()) {}
+
+    class Observer {
+    private:
+        using Handle = typename ObserverList::iterator;
+        std::weak_ptr<ObserverList> list_ptr;
+        Handle handle;
+
+        explicit Observer(const std::shared_ptr<ObserverList>& list, Handle handle) :
+            list_ptr(list), handle(handle)
+        {}
+
+        friend class ListObservable;
+
+    public:
+        ~Observer()
+        {
+            std::shared_ptr<ObserverList> list = list_ptr.lock();
+            if (list) {
+                list->erase(handle);
+            }
+        }
+
+        Observer(const Observer&) = delete;
+        Observer& operator=(const Observer&) = delete;
+        Observer(Observer&&) = delete;
+        Observer& operator=(Observer&&) = delete;
+    };
+
+    template <typename... Args> void notify(Args&&...args) const
+    {
+        for (const auto& observer : *m_observers) {
+            observer(args...);
+        }
+    }
+
+    [[nodiscard]] Observer subscribe(Function function)
+    {
+        m_observers->emplace_back(std::move(function));
+        return Observer(m_observers, std::prev(m_observers->end()));
+    }
+
+private:
+    std::shared_ptr<ObserverList> m_observers;
+};
+
+template <typename O> struct Holder {
+    typename O::Observer observer;
+};
+
+template <typename O> void subscribe_n(
+    O& observable, std::vector<std::unique_ptr<Holder<O>>>& observers, std::int64_t n, int& sink
+)
+{
+    for (std::int64_t i = 0; i < n; ++i) {
+        observers.emplace_back(new Holder<O>{observable.subscribe([&sink](int v) { sink += v; })});
+    }
+}
+
+void set_allocations_per_notify(benchmark::State& state, std::size_t allocated)
+{
+    state.counters["allocs/notify"] =
+        static_cast<double>(allocated) / static_cast<double>(state.iterations());
+}
+
+template <typename O> void BM_Notify(benchmark::State& state)
+{
+    O observable;
+    int sink = 0;
+    std::vector<std::unique_ptr<Holder<O>>> observers;
+    subscribe_n(observable, observers, state.range(0), sink);
+
+    const std::size_t before = allocations;
+    for (auto _ : state) {
+        observable.notify(1);
+        benchmark::DoNotOptimize(sink);
+    }
+    set_allocations_per_notify(state, allocations - before);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <std::size_t N> struct Payload {
+    std::array<char, N> bytes{};
+};
+
+// Notifies with a payload of N bytes, passed by const reference
+template <template <typename...> class O, std::size_t N>
+void BM_NotifyPayload(benchmark::State& state)
+{
+    using Observable = O<const Payload<N>&>;
+    struct PayloadHolder {
+        typename Observable::Observer observer;
+    };
+
+    Observable observable;
+    char sink = 0;
+    std::vector<std::unique_ptr<PayloadHolder>> observers;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        observers.emplace_back(new PayloadHolder{observable.subscribe([&sink](const Payload<N>& p) {
+            sink += p.bytes[N - 1];
+        })});
+    }
+    const Payload<N> payload{};
+
+    const std::size_t before = allocations;
+    for (auto _ : state) {
+        observable.notify(payload);
+        benchmark::DoNotOptimize(sink);
+    }
+    set_allocations_per_notify(state, allocations - before);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Notifies with a heap-allocated std::string taken by value, so every
+// observer call of Observable copies it. ForwardingObservable's observers get
+// a const reference instead.
+template <typename O> void BM_NotifyString(benchmark::State& state)
+{
+    struct StringHolder {
+        typename O::Observer observer;
+    };
+
+    O observable;
+    std::size_t sink = 0;
+    std::vector<std::unique_ptr<StringHolder>> observers;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        observers.emplace_back(new StringHolder{observable.subscribe([&sink](const std::string& s) {
+            sink += s.size();
+        })});
+    }
+    const std::string value(256, 'x');
+
+    const std::size_t before = allocations;
+    for (auto _ : state) {
+        observable.notify(value);
+        benchmark::DoNotOptimize(sink);
+    }
+    set_allocations_per_notify(state, allocations - before);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Times each notify individually and reports percentiles of the latency in
+// nanoseconds. The clock reads add a roughly constant overhead.
+template <typename O> void BM_NotifyLatency(benchmark::State& state)
+{
+    using clock = std::chrono::steady_clock;
+
+    O observable;
+    int sink = 0;
+    std::vector<std::unique_ptr<Holder<O>>> observers;
+    subscribe_n(observable, observers, state.range(0), sink);
+
+    std::vector<std::int64_t> samples;
+    samples.reserve(1 << 20);
+    for (auto _ : state) {
+        const auto start = clock::now();
+        observable.notify(1);
+        const auto end = clock::now();
+        if (samples.size() < samples.capacity()) {
+            samples.push_back(std::chrono::nanoseconds(end - start).count());
+        }
+        benchmark::DoNotOptimize(sink);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    constexpr std::pair<const char *, double> percentiles[] = {
+        {"p50", 0.5}, {"p99", 0.99}, {"p999", 0.999}
+    };
+    for (const auto& [name, fraction] : percentiles) {
+        const auto index = static_cast<std::size_t>(fraction * (samples.size() - 1));
+        state.counters[name] = static_cast<double>(samples[index]);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// As BM_Notify, but with other allocations made between subscriptions, as
+// happens in a long-running program. List nodes end up scattered over the heap.
+template <typename O> void BM_NotifyFragmented(benchmark::State& state)
+{
+    O observable;
+    int sink = 0;
+    std::vector<std::unique_ptr<Holder<O>>> observers;
+    std::vector<std::unique_ptr<char[]>> garbage;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        subscribe_n(observable, observers, 1, sink);
+        garbage.emplace_back(new char[64 + (i * 37) % 512]);
+    }
+
+    for (auto _ : state) {
+        observable.notify(1);
+        benchmark::DoNotOptimize(sink);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename O> void BM_SubscribeUnsubscribe(benchmark::State& state)
+{
+    O observable;
+    int sink = 0;
+    for (auto _ : state) {
+        std::vector<std::unique_ptr<Holder<O>>> observers;
+        subscribe_n(observable, observers, state.range(0), sink);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void observer_counts(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->ArgName("observers")->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+}
+
+}; // namespace
+
+BENCHMARK(BM_Notify<ListObservable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_Notify<Observable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_Notify<ConcurrentObservable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyPayload<ListObservable, 64>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyPayload<Observable, 64>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyPayload<Observable, 4096>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyString<Observable<std::string>>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyString<ForwardingObservable<std::string>>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyLatency<ListObservable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyLatency<Observable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyLatency<ConcurrentObservable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_NotifyFragmented<ListObservable<int>>)->RangeMultiplier(16)->Range(1, 65536);
+BENCHMARK(BM_NotifyFragmented<Observable<int>>)->RangeMultiplier(16)->Range(1, 65536);
+BENCHMARK(BM_SubscribeUnsubscribe<ListObservable<int>>)->Apply(observer_counts);
+BENCHMARK(BM_SubscribeUnsubscribe<Observable<int>>)->Apply(observer_counts);
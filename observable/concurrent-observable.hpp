@@ -0,0 +1,243 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_CONCURRENT_OBSERVABLE_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_CONCURRENT_OBSERVABLE_HPP_INCLUDE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * A thread-safe Observable. notify() may be called from any number of threads
+ * concurrently with subscribe() and with Observers being destroyed.
+ *
+ * notify() never takes a lock: it walks an immutable snapshot of the observer
+ * list. Subscribing and unsubscribing publish a new copy of the snapshot and
+ * the old copy is freed once no notify() can still be reading it (an RCU-style
+ * grace period), so subscription changes are comparatively expensive.
+ *
+ * Once an Observer's destructor returns its function will not be called
+ * again. The exception is an Observer destroyed from inside a notification of
+ * the same Observable: it will not be called again on that thread, but a
+ * concurrent notify() on another thread may still be calling it.
+ */
+template <typename... Ts> class ConcurrentObservable {
+public:
+    using Function = std::function<void(Ts...)>;
+
+private:
+    struct Callback {
+        explicit Callback(Function function) : function(std::move(function)) {}
+
+        Function function;
+        std::atomic<bool> active{true};
+    };
+
+    struct Entry {
+        std::uint64_t id;
+        std::shared_ptr<Callback> callback;
+    };
+
+    using Snapshot = std::vector<Entry>;
+
+    class State {
+    public:
+        State() : m_current(new Snapshot()) {}
+
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+
+        ~State()
+        {
+            delete m_current.load();
+            for (const Snapshot *snapshot : m_retired) {
+                delete snapshot;
+            }
+        }
+
+        // Calls function with the current snapshot. Never blocks.
+        template <typename F> void read(F&& function) const
+        {
+            ReadGuard guard(*this);
+            function(*m_current.load());
+        }
+
+        std::uint64_t add(Function function)
+        {
+            std::uint64_t id;
+            update([&](Snapshot& snapshot) {
+                id = m_next_id++;
+                snapshot.push_back({id, std::make_shared<Callback>(std::move(function))});
+            });
+            return id;
+        }
+
+        void remove(std::uint64_t id)
+        {
+            update([&](Snapshot& snapshot) {
+                for (auto it = snapshot.begin(); it != snapshot.end(); ++it) {
+                    if (it->id == id) {
+                        it->callback->active.store(false);
+                        snapshot.erase(it);
+                        break;
+                    }
+                }
+            });
+        }
+
+    private:
+        // Tracks the notify() calls in progress on the current thread, so that
+        // subscription changes made from inside a notification don't wait for
+        // themselves to finish.
+        class ReadGuard {
+        public:
+            explicit ReadGuard(const State& state) :
+                m_state(state),
+                m_readers(state.m_readers[state.m_epoch.load() & 1].count),
+                m_outer(t_innermost)
+            {
+                m_readers.fetch_add(1);
+                t_innermost = this;
+            }
+
+            ~ReadGuard()
+            {
+                t_innermost = m_outer;
+                m_readers.fetch_sub(1, std::memory_order_release);
+            }
+
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+
+            static bool reading(const State& state)
+            {
+                for (const ReadGuard *guard = t_innermost; guard; guard = guard->m_outer) {
+                    if (&guard->m_state == &state) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+        private:
+            static inline thread_local const ReadGuard *t_innermost = nullptr;
+
+            const State& m_state;
+            std::atomic<std::size_t>& m_readers;
+            const ReadGuard *m_outer;
+        };
+
+        struct alignas(64) ReaderCount {
+            std::atomic<std::size_t> count{0};
+        };
+
+        std::atomic<const Snapshot *> m_current;
+        std::atomic<unsigned> m_epoch{0};
+        mutable ReaderCount m_readers[2];
+
+        std::mutex m_update_mutex;
+        std::uint64_t m_next_id = 0;
+        std::vector<const Snapshot *> m_retired;
+
+        std::mutex m_synchronize_mutex;
+
+        template <typename F> void update(F&& modify)
+        {
+            std::vector<const Snapshot *> retired;
+            {
+                std::lock_guard lock(m_update_mutex);
+                auto next = std::make_unique<Snapshot>(*m_current.load());
+                modify(*next);
+                m_retired.push_back(m_current.exchange(next.release()));
+                if (ReadGuard::reading(*this)) {
+                    // Freed by a later update or the destructor
+                    return;
+                }
+                retired.swap(m_retired);
+            }
+
+            synchronize();
+            for (const Snapshot *snapshot : retired) {
+                delete snapshot;
+            }
+        }
+
+        // Waits until every notify() that started before this call has
+        // finished. Flipping the epoch twice waits for both reader counts to
+        // drain, including readers that loaded the epoch before a previous
+        // flip.
+        void synchronize()
+        {
+            std::lock_guard lock(m_synchronize_mutex);
+            for (int i = 0; i < 2; ++i) {
+                const unsigned epoch = m_epoch.fetch_add(1);
+                while (m_readers[epoch & 1].count.load() != 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+public:
+    ConcurrentObservable() : m_state(std::make_shared<State>()) {}
+
+    class Observer {
+    private:
+        std::weak_ptr<State> state_ptr;
+        std::uint64_t id;
+
+        explicit Observer(const std::shared_ptr<State>& state, std::uint64_t id) :
+            state_ptr(state), id(id)
+        {}
+
+        friend class ConcurrentObservable;
+
+    public:
+        ~Observer()
+        {
+            std::shared_ptr<State> state = state_ptr.lock();
+            if (state) {
+                state->remove(id);
+            }
+        }
+
+        Observer(const Observer&) = delete;
+        Observer& operator=(const Observer&) = delete;
+        Observer(Observer&&) = delete;
+        Observer& operator=(Observer&&) = delete;
+    };
+
+    [[nodiscard]] std::size_t num_observers() const
+    {
+        std::size_t count = 0;
+        m_state->read([&](const Snapshot& snapshot) { count = snapshot.size(); });
+        return count;
+    }
+
+    template <typename... Args> void notify(Args&&...args) const
+    {
+        m_state->read([&](const Snapshot& snapshot) {
+            for (const auto& entry : snapshot) {
+                if (entry.callback->active.load(std::memory_order_relaxed)) {
+                    entry.callback->function(args...);
+                }
+            }
+        });
+    }
+
+    [[nodiscard]] Observer subscribe(Function function)
+    {
+        return Observer(m_state, m_state->add(std::move(function)));
+    }
+
+private:
+    std::shared_ptr<State> m_state;
+};
+
+template <typename... Ts> using ConcurrentObserver = typename ConcurrentObservable<Ts...>::Observer;
+
+#endif // HARRYMANDER_CPP_SNIPPETS_CONCURRENT_OBSERVABLE_HPP_INCLUDE
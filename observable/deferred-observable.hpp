@@ -0,0 +1,152 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_DEFERRED_OBSERVABLE_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_DEFERRED_OBSERVABLE_HPP_INCLUDE
+
+#include "observable.hpp"
+#include "small-function.hpp"
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Coalescing policies for DeferredObservable. Each describes the Batch that
+// observers receive on flush(), how a notified value is added to it, and how
+// it is reset after a flush.
+
+// Observers receive only the most recent value
+template <typename T> struct LatestValue {
+    using value_type = T;
+    using Batch = T;
+
+    void add(Batch& batch, const T& value) const { batch = value; }
+
+    void add(Batch& batch, T&& value) const { batch = std::move(value); }
+
+    void reset(Batch&) const {}
+};
+
+// Observers receive every value notified since the last flush, in order
+template <typename T> struct KeepAll {
+    using value_type = T;
+    using Batch = std::vector<T>;
+
+    void add(Batch& batch, const T& value) const { batch.push_back(value); }
+
+    void add(Batch& batch, T&& value) const { batch.push_back(std::move(value)); }
+
+    // Keeps the vector's capacity for the next batch
+    void reset(Batch& batch) const { batch.clear(); }
+};
+
+// Observers receive the values folded together with `op`, starting from
+// `initial`; e.g. the sum of the values by default.
+template <typename T, typename BinaryOp = std::plus<T>> struct Accumulate {
+    using value_type = T;
+    using Batch = T;
+
+    BinaryOp op{};
+    T initial{};
+
+    void add(Batch& batch, const T& value) const { batch = op(std::move(batch), value); }
+
+    void reset(Batch& batch) const { batch = initial; }
+};
+
+/**
+ * An Observable that coalesces notifications and delivers them in batches.
+ * notify() only adds the value to the pending batch according to Policy;
+ * observers are called once per flush() with the whole batch:
+ *
+ *   DeferredObservable<LatestValue<int>> position;
+ *   auto sub = position.subscribe([](const int& latest) { draw(latest); });
+ *   position.notify(1);
+ *   position.notify(2);
+ *   position.flush(); // observer is called once, with 2
+ *
+ * Instead of calling flush() directly, a scheduler can be set. It is given a
+ * task that flushes the observable whenever the first value of a new batch
+ * is notified, and should run it later, e.g. at the end of the current frame
+ * or on an event loop. The task does nothing if the observable has been
+ * destroyed by then.
+ *
+ * NOT THREAD SAFE.
+ */
+template <typename Policy> class DeferredObservable {
+public:
+    using value_type = typename Policy::value_type;
+    using Batch = typename Policy::Batch;
+    using Function = typename Observable<const Batch&>::Function;
+    using Observer = typename Observable<const Batch&>::Observer;
+    using Task = SmallFunction<void()>;
+    using Scheduler = std::function<void(Task)>;
+    using size_type = typename Observable<const Batch&>::size_type;
+
+    explicit DeferredObservable(Policy policy = {}) :
+        m_policy(std::move(policy)), m_alive(std::make_shared<bool>(true))
+    {
+        m_policy.reset(m_batch);
+        m_policy.reset(m_delivering);
+    }
+
+    DeferredObservable(const DeferredObservable&) = delete;
+    DeferredObservable& operator=(const DeferredObservable&) = delete;
+    DeferredObservable(DeferredObservable&&) = delete;
+    DeferredObservable& operator=(DeferredObservable&&) = delete;
+
+    void set_scheduler(Scheduler scheduler) { m_scheduler = std::move(scheduler); }
+
+    [[nodiscard]] size_type num_observers() const { return m_observable.num_observers(); }
+
+    // True if values have been notified since the last flush
+    [[nodiscard]] bool pending() const { return m_pending; }
+
+    template <typename Arg> void notify(Arg&& value)
+    {
+        m_policy.add(m_batch, std::forward<Arg>(value));
+        if (!m_pending) {
+            m_pending = true;
+            schedule();
+        }
+    }
+
+    // Calls every observer once with the pending batch, if there is one.
+    // Values notified by observers during the flush go into the next batch.
+    void flush()
+    {
+        if (!m_pending) {
+            return;
+        }
+
+        m_pending = false;
+        std::swap(m_batch, m_delivering);
+        m_observable.notify(std::as_const(m_delivering));
+        m_policy.reset(m_delivering);
+    }
+
+    [[nodiscard]] Observer subscribe(Function function)
+    {
+        return m_observable.subscribe(std::move(function));
+    }
+
+private:
+    Policy m_policy;
+    Batch m_batch;
+    Batch m_delivering;
+    bool m_pending = false;
+    Observable<const Batch&> m_observable;
+    Scheduler m_scheduler;
+    std::shared_ptr<bool> m_alive;
+
+    void schedule()
+    {
+        if (m_scheduler) {
+            m_scheduler([this, alive = std::weak_ptr<bool>(m_alive)] {
+                if (alive.lock()) {
+                    flush();
+                }
+            });
+        }
+    }
+};
+
+#endif // HARRYMANDER_CPP_SNIPPETS_DEFERRED_OBSERVABLE_HPP_INCLUDE
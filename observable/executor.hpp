@@ -0,0 +1,104 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_EXECUTOR_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_EXECUTOR_HPP_INCLUDE
+
+#include "small-function.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs tasks somewhere, e.g. on a thread pool or a dedicated worker thread.
+// execute() may be called from any thread.
+class Executor {
+public:
+    using Task = SmallFunction<void()>;
+
+    virtual ~Executor() = default;
+
+    virtual void execute(Task task) = 0;
+};
+
+// Runs each task immediately on the calling thread
+class InlineExecutor final : public Executor {
+public:
+    void execute(Task task) override { task(); }
+};
+
+// Runs tasks in FIFO order on a fixed number of threads. A ThreadPool with one
+// thread is a dedicated worker. The destructor runs the tasks still queued
+// before joining the threads. An exception thrown by a task is discarded, as
+// there is no caller to report it to, and the thread goes on to the next task.
+class ThreadPool final : public Executor {
+public:
+    explicit ThreadPool(std::size_t num_threads = std::thread::hardware_concurrency())
+    {
+        if (num_threads == 0) {
+            num_threads = 1;
+        }
+        m_threads.reserve(num_threads);
+        for (std::size_t i = 0; i < num_threads; ++i) {
+            m_threads.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ThreadPool() override
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_ready.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    [[nodiscard]] std::size_t num_threads() const { return m_threads.size(); }
+
+    void execute(Task task) override
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_ready.notify_one();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<Task> m_tasks;
+    bool m_stopping = false;
+    std::vector<std::thread> m_threads;
+
+    void run()
+    {
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_ready.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            try {
+                task();
+            } catch (...) {
+            }
+        }
+    }
+};
+
+#endif // HARRYMANDER_CPP_SNIPPETS_EXECUTOR_HPP_INCLUDE
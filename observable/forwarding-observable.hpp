@@ -0,0 +1,112 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_FORWARDING_OBSERVABLE_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_FORWARDING_OBSERVABLE_HPP_INCLUDE
+
+#include "observable.hpp"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * An Observable for by-value argument types, such as std::string or
+ * std::vector, that avoids copying the arguments for every observer.
+ *
+ * notify() converts its arguments to Ts... at most once, and observers
+ * subscribed with subscribe() receive them by const reference. Observers
+ * subscribed with subscribe_owning() receive them as rvalues they can take
+ * ownership of: the last observer called is given the notified values
+ * themselves, moved if notify() was given rvalues, and any other owning
+ * observer is given its own copy.
+ *
+ *   ForwardingObservable<std::string> lines;
+ *   auto log = lines.subscribe([](const std::string& line) { print(line); });
+ *   auto store = lines.subscribe_owning([&](std::string&& line) {
+ *       history.push_back(std::move(line));
+ *   });
+ *   lines.notify(read_line()); // no copies of the string
+ *
+ * NOT THREAD SAFE.
+ */
+template <typename... Ts> class ForwardingObservable {
+private:
+    // The values of one notify, shared by the observer calls
+    struct Delivery {
+        std::tuple<const Ts&...> values;
+        bool movable;          // values are rvalues that may be moved from
+        std::size_t remaining; // observer calls left, including the current one
+    };
+
+    using Inner = Observable<Delivery&>;
+
+public:
+    using Observer = typename Inner::Observer;
+    using size_type = typename Inner::size_type;
+
+    ForwardingObservable() = default;
+
+    ForwardingObservable(const ForwardingObservable&) = delete;
+    ForwardingObservable& operator=(const ForwardingObservable&) = delete;
+    ForwardingObservable(ForwardingObservable&&) = delete;
+    ForwardingObservable& operator=(ForwardingObservable&&) = delete;
+
+    [[nodiscard]] size_type num_observers() const { return m_observable.num_observers(); }
+
+    template <typename... Args> void notify(Args&&...args) const
+    {
+        if constexpr (
+            sizeof...(Args) == sizeof...(Ts)
+            && (std::is_same_v<std::remove_cvref_t<Args>, Ts> && ...)
+        ) {
+            constexpr bool movable =
+                ((!std::is_lvalue_reference_v<Args> && !std::is_const_v<std::remove_reference_t<Args>>)
+                 && ...);
+            deliver(movable, args...);
+        } else {
+            // Materialise the values once rather than in every observer call
+            std::tuple<Ts...> values(std::forward<Args>(args)...);
+            std::apply([this](Ts&...materialised) { deliver(true, materialised...); }, values);
+        }
+    }
+
+    // function is called with const references to the notified values
+    template <typename F>
+    requires std::is_invocable_v<F&, const Ts&...>
+    [[nodiscard]] Observer subscribe(F function)
+    {
+        return m_observable.subscribe([function = std::move(function)](Delivery& delivery) mutable {
+            --delivery.remaining;
+            std::apply(function, delivery.values);
+        });
+    }
+
+    // function is called with rvalues it may move from
+    template <typename F>
+    requires std::is_invocable_v<F&, Ts&&...>
+    [[nodiscard]] Observer subscribe_owning(F function)
+    {
+        return m_observable.subscribe([function = std::move(function)](Delivery& delivery) mutable {
+            if (--delivery.remaining == 0 && delivery.movable) {
+                std::apply(
+                    [&function](const Ts&...values) {
+                        function(std::move(const_cast<Ts&>(values))...);
+                    },
+                    delivery.values
+                );
+            } else {
+                std::apply([&function](const Ts&...values) { function(Ts(values)...); }, delivery.values);
+            }
+        });
+    }
+
+private:
+    Inner m_observable;
+
+    void deliver(bool movable, const Ts&...values) const
+    {
+        Delivery delivery{{values...}, movable, m_observable.num_observers()};
+        m_observable.notify(delivery);
+    }
+};
+
+#endif // HARRYMANDER_CPP_SNIPPETS_FORWARDING_OBSERVABLE_HPP_INCLUDE
@@ -1,65 +1,454 @@
 #ifndef HARRYMANDER_CPP_SNIPPETS_OBSERVABLE_HPP_INCLUDE
 #define HARRYMANDER_CPP_SNIPPETS_OBSERVABLE_HPP_INCLUDE
 
+#include "small-function.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <list>
-#include <memory>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 template <typename... Ts> class Observable {
 public:
-    using Function = std::function<void(Ts...)>;
-    using ObserverList = std::list<Function>;
+    using Function = SmallFunction<void(Ts...)>;
+    using size_type = std::size_t;
+    using priority_type = int;
+
+private:
+    // Observer functions are stored contiguously in dispatch order (highest
+    // priority first, then subscription order), so notify() is a linear scan.
+    // Observers refer to their function through a generation-tagged slot,
+    // which stays valid when other functions move during insertion and
+    // compaction.
+    //
+    // The functions must not move while notify() is iterating over them, so
+    // changes made by observers during a notify() are deferred until the
+    // outermost notify() returns. A removed function is skipped at once but
+    // destroyed afterwards, as it may be the one running. An added function
+    // is held aside, and first called by the next notify().
+    //
+    // The list is the one allocation shared by the Observable, its copies and
+    // its Observers. It counts its own references, from each of them, and
+    // deletes itself when the last is released, or once the outermost
+    // notify() returns. When the last Observable sharing the list is destroyed
+    // the list is closed: its functions are destroyed and later removals do
+    // nothing.
+    class ObserverList {
+    public:
+        struct Handle {
+            std::uint32_t slot;
+            std::uint32_t generation;
+        };
+
+        void retain() { ++m_references; }
+
+        // Called for each Observable sharing the list, which is closed when
+        // the last of them is released
+        void share()
+        {
+            ++m_observables;
+            retain();
+        }
+
+        static void release_shared(ObserverList *list)
+        {
+            if (--list->m_observables == 0) {
+                list->close();
+            }
+            release(list);
+        }
+
+        static void release(ObserverList *list)
+        {
+            if (--list->m_references == 0 && list->m_depth == 0) {
+                delete list;
+            }
+        }
+
+        // A running notify() calls no more observers
+        void close()
+        {
+            m_closed = true;
+            if (m_depth > 0) {
+                m_deferred = true;
+            } else {
+                clear();
+            }
+        }
+
+        [[nodiscard]] size_type size() const
+        {
+            return m_functions.size() - m_removed + m_pending.size();
+        }
+
+        Handle add(Function function, priority_type priority)
+        {
+            if (!function) {
+                function = [](auto&&...) {};
+            }
+
+            std::uint32_t slot;
+            if (m_free_slots.empty()) {
+                slot = static_cast<std::uint32_t>(m_slots.size());
+                m_slots.push_back({});
+            } else {
+                slot = m_free_slots.back();
+                m_free_slots.pop_back();
+            }
+
+            if (m_depth > 0) {
+                m_deferred = true;
+                m_slots[slot].index = pending_index;
+                m_pending.push_back({std::move(function), priority, slot});
+            } else {
+                insert(std::move(function), priority, slot);
+            }
+            return {slot, m_slots[slot].generation};
+        }
+
+        void remove(Handle handle)
+        {
+            if (m_closed) {
+                return;
+            }
+            Slot& slot = m_slots[handle.slot];
+            if (slot.generation != handle.generation) {
+                return;
+            }
+
+            // Destroyed on return, once the list is consistent, in case it
+            // owns other observers
+            Function removed;
+            if (slot.index == pending_index) {
+                const auto pending = std::find_if(
+                    m_pending.begin(), m_pending.end(),
+                    [&](const PendingAdd& add) { return add.slot == handle.slot; }
+                );
+                removed = std::move(pending->function);
+                m_pending.erase(pending);
+            } else {
+                // Leave a gap rather than shifting the functions after it; gaps
+                // are compacted once they make up half of the list.
+                m_owners[slot.index] = removed_owner;
+                ++m_removed;
+                if (m_depth == 0) {
+                    removed = std::move(m_functions[slot.index]);
+                } else {
+                    m_deferred = true;
+                }
+            }
+            ++slot.generation;
+            m_free_slots.push_back(handle.slot);
+
+            if (m_depth == 0 && m_removed * 2 >= m_functions.size()) {
+                compact();
+            }
+        }
+
+        // Returns true if a handler stopped the dispatch
+        template <typename... Args> bool notify(Args&...args)
+        {
+            bool handled = false;
+            bool *const outer = std::exchange(m_handled, &handled);
+            ++m_depth;
+            try {
+                // Functions added during the dispatch are pending, so the
+                // number of entries stays the same
+                const std::size_t count = m_functions.size();
+                for (std::size_t i = 0; i < count && !handled; ++i) {
+                    // Functions removed outside notify() are null. Those
+                    // removed during it are only marked in m_owners.
+                    if (m_functions[i]
+                        && (!m_deferred || (!m_closed && m_owners[i] != removed_owner))) {
+                        m_functions[i](args...);
+                    }
+                }
+            } catch (...) {
+                end_notify(outer);
+                throw;
+            }
+            end_notify(outer);
+            return handled;
+        }
+
+        // Called by a handler's function to stop the current notify()
+        void stop() { *m_handled = true; }
 
-    Observable() : m_observers(std::make_shared<ObserverList>()) {}
+    private:
+        struct Slot {
+            std::uint32_t index = 0;
+            std::uint32_t generation = 0;
+        };
+
+        struct PendingAdd {
+            Function function;
+            priority_type priority;
+            std::uint32_t slot;
+        };
+
+        // m_owners entry of a removed function
+        static constexpr std::uint32_t removed_owner = ~std::uint32_t(0);
+        // Slot index of a function added during notify()
+        static constexpr std::uint32_t pending_index = ~std::uint32_t(0);
+
+        std::vector<Function> m_functions;
+        std::vector<std::uint32_t> m_owners; // the slot of each entry in m_functions
+        std::vector<priority_type> m_priorities; // of each entry, in descending order
+        std::vector<Slot> m_slots;
+        std::vector<std::uint32_t> m_free_slots;
+        size_type m_removed = 0;
+        std::vector<PendingAdd> m_pending;
+        size_type m_depth = 0; // of nested notify() calls
+        bool *m_handled = nullptr; // set by the innermost notify()
+        bool m_deferred = false;   // changes were made during notify()
+        std::size_t m_references = 1;
+        std::size_t m_observables = 1; // sharing the list
+        bool m_closed = false;
+
+        void insert(Function function, priority_type priority, std::uint32_t slot)
+        {
+            // After every function of the same or a higher priority. With
+            // equal priorities this is the end, and nothing has to move.
+            const auto position = static_cast<std::size_t>(
+                std::upper_bound(
+                    m_priorities.begin(), m_priorities.end(), priority, std::greater<>()
+                )
+                - m_priorities.begin()
+            );
+            m_functions.insert(m_functions.begin() + position, std::move(function));
+            m_owners.insert(m_owners.begin() + position, slot);
+            m_priorities.insert(m_priorities.begin() + position, priority);
+            for (std::size_t i = position; i < m_owners.size(); ++i) {
+                if (m_owners[i] != removed_owner) {
+                    m_slots[m_owners[i]].index = static_cast<std::uint32_t>(i);
+                }
+            }
+        }
 
+        // May delete the list
+        void end_notify(bool *outer)
+        {
+            m_handled = outer;
+            if (m_depth == 1) {
+                // Still counted as in notify(), so that changes made by the
+                // destroyed functions are deferred too
+                while (m_deferred) {
+                    apply_deferred();
+                }
+            }
+            if (--m_depth == 0 && m_references == 0) {
+                delete this;
+            }
+        }
+
+        void apply_deferred()
+        {
+            m_deferred = false;
+            if (m_closed) {
+                clear();
+                return;
+            }
+
+            std::vector<Function> removed;
+            if (m_removed != 0) {
+                for (std::size_t i = 0; i < m_functions.size(); ++i) {
+                    if (m_owners[i] == removed_owner && m_functions[i]) {
+                        removed.push_back(std::move(m_functions[i]));
+                    }
+                }
+            }
+            for (PendingAdd& add : std::exchange(m_pending, {})) {
+                insert(std::move(add.function), add.priority, add.slot);
+            }
+            if (m_removed * 2 >= m_functions.size() && m_removed != 0) {
+                compact();
+            }
+        }
+
+        void clear()
+        {
+            // Destroyed after the list is emptied, in case they own Observers
+            std::vector<Function> functions = std::exchange(m_functions, {});
+            std::vector<PendingAdd> pending = std::exchange(m_pending, {});
+            m_owners.clear();
+            m_priorities.clear();
+            m_removed = 0;
+        }
+
+        void compact()
+        {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < m_functions.size(); ++i) {
+                if (m_owners[i] == removed_owner) {
+                    continue;
+                }
+                if (i != kept) {
+                    m_functions[kept] = std::move(m_functions[i]);
+                    m_owners[kept] = m_owners[i];
+                    m_priorities[kept] = m_priorities[i];
+                }
+                m_slots[m_owners[kept]].index = static_cast<std::uint32_t>(kept);
+                ++kept;
+            }
+            m_functions.resize(kept);
+            m_owners.resize(kept);
+            m_priorities.resize(kept);
+            m_removed = 0;
+        }
+    };
+
+public:
+    Observable() : m_observers(new ObserverList) {}
+
+    ~Observable()
+    {
+        if (m_observers) {
+            ObserverList::release_shared(m_observers);
+        }
+    }
+
+    // A copy shares the observers: notifying either notifies all of them, and
+    // they stay subscribed until the last copy is destroyed.
+    Observable(const Observable& other) : m_observers(other.m_observers)
+    {
+        if (m_observers) {
+            m_observers->share();
+        }
+    }
+
+    Observable& operator=(const Observable& other)
+    {
+        Observable(other).swap(*this);
+        return *this;
+    }
+
+    // Observers stay subscribed to the moved-to Observable. The moved-from
+    // one has no observers, and new ones can be subscribed to it.
+    Observable(Observable&& other) noexcept :
+        m_observers(std::exchange(other.m_observers, nullptr))
+    {}
+
+    Observable& operator=(Observable&& other) noexcept
+    {
+        Observable(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(Observable& other) noexcept { std::swap(m_observers, other.m_observers); }
+
+    // A subscription, which is cancelled when the Observer is destroyed or
+    // assigned to. Observers can be moved, e.g. stored by value in a vector,
+    // and a default-constructed or moved-from Observer is not subscribed.
     class Observer {
     private:
-        using Handle = typename ObserverList::iterator;
-        std::weak_ptr<ObserverList> list_ptr;
-        Handle handle;
+        using Handle = typename ObserverList::Handle;
+        ObserverList *list_ptr = nullptr;
+        Handle handle{};
 
-        explicit Observer(const std::shared_ptr<ObserverList>& list, Handle handle) :
-            list_ptr(list), handle(handle)
-        {}
+        explicit Observer(ObserverList *list, Handle handle) : list_ptr(list), handle(handle)
+        {
+            list->retain();
+        }
 
         friend class Observable;
 
     public:
-        ~Observer()
+        Observer() = default;
+
+        ~Observer() { reset(); }
+
+        Observer(const Observer&) = delete;
+        Observer& operator=(const Observer&) = delete;
+
+        Observer(Observer&& other) noexcept :
+            list_ptr(std::exchange(other.list_ptr, nullptr)), handle(other.handle)
+        {}
+
+        Observer& operator=(Observer&& other) noexcept
+        {
+            Observer(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        void swap(Observer& other) noexcept
         {
-            std::shared_ptr<ObserverList> list = list_ptr.lock();
+            std::swap(list_ptr, other.list_ptr);
+            std::swap(handle, other.handle);
+        }
+
+        friend void swap(Observer& a, Observer& b) noexcept { a.swap(b); }
+
+        // Unsubscribes, if subscribed
+        void reset()
+        {
+            // Cleared first: removing the function may destroy this Observer,
+            // if the function owns it
+            ObserverList *list = std::exchange(list_ptr, nullptr);
             if (list) {
-                list->erase(handle);
+                list->remove(handle);
+                ObserverList::release(list);
             }
         }
 
-        Observer(const Observer&) = delete;
-        Observer& operator=(const Observer&) = delete;
-        Observer(Observer&&) = delete;
-        Observer& operator=(Observer&&) = delete;
+        [[nodiscard]] bool subscribed() const { return list_ptr != nullptr; }
     };
 
-    [[nodiscard]] typename ObserverList::size_type num_observers() const
+    [[nodiscard]] size_type num_observers() const
     {
-        return m_observers->size();
+        return m_observers ? m_observers->size() : 0;
     }
 
-    template <typename... Args> void notify(Args&&...args) const
+    // Calls the observers in order of priority, highest first, and otherwise
+    // in subscription order. Returns true if a handler returned true, which
+    // skips the observers after it.
+    //
+    // Observers may subscribe and unsubscribe (including themselves) during
+    // notify(), or call notify() again. An observer unsubscribed during
+    // notify() is not called again; one subscribed during notify() is first
+    // called by the next notify(). If the last Observable sharing the
+    // observers is destroyed during notify(), no more observers are called.
+    template <typename... Args> bool notify(Args&&...args) const
     {
-        for (const auto& observer : *m_observers) {
-            observer(args...);
-        }
+        return m_observers && m_observers->notify(args...);
     }
 
-    [[nodiscard]] Observer subscribe(Function function)
+    [[nodiscard]] Observer subscribe(Function function, priority_type priority = 0)
     {
-        m_observers->emplace_back(std::move(function));
-        return Observer(m_observers, std::prev(m_observers->end()));
+        ObserverList *list = observers();
+        return Observer(list, list->add(std::move(function), priority));
+    }
+
+    // Subscribes a function returning bool, which stops the notify() when it
+    // returns true. E.g. a cheap filter subscribed with a high priority can
+    // stop an event from reaching expensive observers.
+    template <typename F>
+    requires std::is_invocable_r_v<bool, F&, Ts...>
+    [[nodiscard]] Observer subscribe_handler(F handler, priority_type priority = 0)
+    {
+        ObserverList *list = observers();
+        return subscribe(
+            [handler = std::move(handler), list](auto&&...args) mutable {
+                if (handler(std::forward<decltype(args)>(args)...)) {
+                    list->stop();
+                }
+            },
+            priority
+        );
     }
 
 private:
-    std::shared_ptr<ObserverList> m_observers;
+    ObserverList *m_observers; // null once moved from
+
+    ObserverList *observers()
+    {
+        if (!m_observers) {
+            m_observers = new ObserverList;
+        }
+        return m_observers;
+    }
 };
 
 template <typename... Ts> using Observer = typename Observable<Ts...>::Observer;
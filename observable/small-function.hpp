@@ -0,0 +1,172 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_SMALL_FUNCTION_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_SMALL_FUNCTION_HPP_INCLUDE
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, std::size_t BufferSize = 4 * sizeof(void *), bool AllowHeap = true>
+class SmallFunction;
+
+/**
+ * A move-only replacement for std::function that stores callables of up to
+ * BufferSize bytes inside the object, so they can be kept contiguously in a
+ * container without a separate allocation each.
+ *
+ * Larger callables are allocated on the heap unless AllowHeap is false, in
+ * which case constructing from them fails to compile.
+ */
+template <typename R, typename... Args, std::size_t BufferSize, bool AllowHeap>
+class SmallFunction<R(Args...), BufferSize, AllowHeap> {
+private:
+    template <typename F> static constexpr bool fits_inline =
+        sizeof(F) <= BufferSize
+        && alignof(F) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<F>;
+
+    static_assert(
+        !AllowHeap || BufferSize >= sizeof(void *),
+        "BufferSize must be able to hold a pointer to a heap-allocated callable"
+    );
+
+public:
+    SmallFunction() noexcept = default;
+
+    SmallFunction(std::nullptr_t) noexcept {}
+
+    template <typename F>
+    requires
+        (!std::is_same_v<std::remove_cvref_t<F>, SmallFunction>) &&
+        std::is_invocable_r_v<R, std::decay_t<F>&, Args...>
+    SmallFunction(F&& function)
+    {
+        using Callable = std::decay_t<F>;
+        static_assert(
+            AllowHeap || fits_inline<Callable>,
+            "Callable is too large to be stored in SmallFunction without heap allocation"
+        );
+
+        if (is_null(function)) {
+            return;
+        }
+
+        if constexpr (fits_inline<Callable>) {
+            ::new (static_cast<void *>(m_buffer)) Callable(std::forward<F>(function));
+            m_vtable = &inline_vtable<Callable>;
+        } else {
+            ::new (static_cast<void *>(m_buffer)) Callable *(new Callable(std::forward<F>(function)));
+            m_vtable = &heap_vtable<Callable>;
+        }
+    }
+
+    SmallFunction(SmallFunction&& other) noexcept : m_vtable(other.m_vtable)
+    {
+        if (m_vtable) {
+            m_vtable->move(other.m_buffer, m_buffer);
+            other.m_vtable = nullptr;
+        }
+    }
+
+    SmallFunction& operator=(SmallFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other.m_vtable) {
+                other.m_vtable->move(other.m_buffer, m_buffer);
+                m_vtable = std::exchange(other.m_vtable, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    SmallFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    SmallFunction(const SmallFunction&) = delete;
+    SmallFunction& operator=(const SmallFunction&) = delete;
+
+    ~SmallFunction() { reset(); }
+
+    explicit operator bool() const noexcept { return m_vtable != nullptr; }
+
+    R operator()(Args... args) const
+    {
+        if (!m_vtable) {
+            throw std::bad_function_call();
+        }
+        return m_vtable->invoke(m_buffer, std::forward<Args>(args)...);
+    }
+
+private:
+    struct VTable {
+        R (*invoke)(void *, Args&&...);
+        // Move-constructs into `to` and destroys `from`
+        void (*move)(void *from, void *to) noexcept;
+        void (*destroy)(void *) noexcept;
+    };
+
+    // As for std::function, null function and member pointers and empty
+    // std::functions give an empty SmallFunction
+    template <typename F> static bool is_null(const F& function)
+    {
+        if constexpr (std::is_pointer_v<F> || std::is_member_pointer_v<F>) {
+            return function == nullptr;
+        } else {
+            return false;
+        }
+    }
+
+    template <typename Signature> static bool is_null(const std::function<Signature>& function)
+    {
+        return !function;
+    }
+
+    template <typename F> static R invoke(F& function, Args&&...args)
+    {
+        if constexpr (std::is_void_v<R>) {
+            std::invoke(function, std::forward<Args>(args)...);
+        } else {
+            return std::invoke(function, std::forward<Args>(args)...);
+        }
+    }
+
+    template <typename F> static constexpr VTable inline_vtable = {
+        [](void *buffer, Args&&...args) -> R {
+            return invoke(*static_cast<F *>(buffer), std::forward<Args>(args)...);
+        },
+        [](void *from, void *to) noexcept {
+            ::new (to) F(std::move(*static_cast<F *>(from)));
+            static_cast<F *>(from)->~F();
+        },
+        [](void *buffer) noexcept { static_cast<F *>(buffer)->~F(); },
+    };
+
+    template <typename F> static constexpr VTable heap_vtable = {
+        [](void *buffer, Args&&...args) -> R {
+            return invoke(**static_cast<F **>(buffer), std::forward<Args>(args)...);
+        },
+        [](void *from, void *to) noexcept {
+            ::new (to) F *(*static_cast<F **>(from));
+        },
+        [](void *buffer) noexcept { delete *static_cast<F **>(buffer); },
+    };
+
+    const VTable *m_vtable = nullptr;
+    alignas(std::max_align_t) mutable unsigned char m_buffer[BufferSize];
+
+    void reset() noexcept
+    {
+        if (m_vtable) {
+            m_vtable->destroy(m_buffer);
+            m_vtable = nullptr;
+        }
+    }
+};
+
+#endif // HARRYMANDER_CPP_SNIPPETS_SMALL_FUNCTION_HPP_INCLUDE
@@ -0,0 +1,136 @@
+#ifndef HARRYMANDER_CPP_SNIPPETS_STATIC_OBSERVABLE_HPP_INCLUDE
+#define HARRYMANDER_CPP_SNIPPETS_STATIC_OBSERVABLE_HPP_INCLUDE
+
+#include "small-function.hpp"
+
+#include <cstddef>
+#include <utility>
+
+/**
+ * An Observable with room for at most N observers, stored inside the object.
+ * Neither subscribe() nor notify() allocate, so it is usable where the heap
+ * is unavailable (e.g. alongside the freertos++ Static* types).
+ *
+ * Observer functions must fit in FunctionSize bytes; larger callables are
+ * rejected at compile time. If all N slots are in use, subscribe() returns an
+ * Observer that is not subscribed, which can be checked with good().
+ *
+ * As with Observable, an Observer may outlive its StaticObservable.
+ */
+template <std::size_t N, typename... Ts> class StaticObservable {
+public:
+    static_assert(N > 0, "N must be non-zero");
+
+    static constexpr std::size_t FunctionSize = 4 * sizeof(void *);
+
+    using Function = SmallFunction<void(Ts...), FunctionSize, false>;
+    using size_type = std::size_t;
+
+    class Observer {
+    private:
+        StaticObservable *m_observable;
+        size_type m_index;
+
+        // Observers are never moved, so the slot can keep a pointer back to
+        // this object to detach it if the observable is destroyed first.
+        Observer(StaticObservable *observable, size_type index) :
+            m_observable(observable), m_index(index)
+        {
+            if (m_observable) {
+                m_observable->m_slots[m_index].observer = this;
+            }
+        }
+
+        friend class StaticObservable;
+
+    public:
+        ~Observer()
+        {
+            if (m_observable) {
+                m_observable->remove(m_index);
+            }
+        }
+
+        // False if the observable was full when subscribing, or has since been
+        // destroyed.
+        bool good() const { return m_observable != nullptr; }
+
+        explicit operator bool() const { return good(); }
+
+        Observer(const Observer&) = delete;
+        Observer& operator=(const Observer&) = delete;
+        Observer(Observer&&) = delete;
+        Observer& operator=(Observer&&) = delete;
+    };
+
+    StaticObservable() = default;
+
+    ~StaticObservable()
+    {
+        for (auto& slot : m_slots) {
+            if (slot.observer) {
+                slot.observer->m_observable = nullptr;
+            }
+        }
+    }
+
+    StaticObservable(const StaticObservable&) = delete;
+    StaticObservable& operator=(const StaticObservable&) = delete;
+    StaticObservable(StaticObservable&&) = delete;
+    StaticObservable& operator=(StaticObservable&&) = delete;
+
+    [[nodiscard]] size_type num_observers() const { return m_count; }
+
+    static constexpr size_type capacity() { return N; }
+
+    // Observers are called in slot order, which is subscription order unless
+    // a slot freed by an earlier Observer has been reused.
+    template <typename... Args> void notify(Args&&...args) const
+    {
+        for (size_type i = 0; i < m_end; ++i) {
+            if (m_slots[i].observer) {
+                m_slots[i].function(args...);
+            }
+        }
+    }
+
+    [[nodiscard]] Observer subscribe(Function function)
+    {
+        for (size_type i = 0; i < N; ++i) {
+            if (!m_slots[i].observer) {
+                m_slots[i].function = std::move(function);
+                ++m_count;
+                if (i >= m_end) {
+                    m_end = i + 1;
+                }
+                return Observer(this, i);
+            }
+        }
+        return Observer(nullptr, 0);
+    }
+
+private:
+    struct Slot {
+        Function function;
+        Observer *observer = nullptr;
+    };
+
+    Slot m_slots[N];
+    size_type m_count = 0;
+    size_type m_end = 0; // one past the last slot that has been used
+
+    void remove(size_type index)
+    {
+        m_slots[index].function = nullptr;
+        m_slots[index].observer = nullptr;
+        --m_count;
+        while (m_end > 0 && !m_slots[m_end - 1].observer) {
+            --m_end;
+        }
+    }
+};
+
+template <std::size_t N, typename... Ts>
+using StaticObserver = typename StaticObservable<N, Ts...>::Observer;
+
+#endif // HARRYMANDER_CPP_SNIPPETS_STATIC_OBSERVABLE_HPP_INCLUDE
@@ -0,0 +1,312 @@
+#include "async-observable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using TestObservable = AsyncObservable<int>;
+
+struct ObserverHolder {
+    AsyncObserver<int> observer;
+};
+
+TEST(TestAsyncObservable, TestSubscribeAndUnsubscribe)
+{
+    InlineExecutor executor;
+    TestObservable obs;
+    EXPECT_EQ(obs.num_observers(), 0);
+    {
+        auto sub1 = obs.subscribe(executor, [](int) {});
+        {
+            auto sub2 = obs.subscribe(executor, [](int) {});
+            EXPECT_EQ(obs.num_observers(), 2);
+        }
+        EXPECT_EQ(obs.num_observers(), 1);
+    }
+    EXPECT_EQ(obs.num_observers(), 0);
+}
+
+TEST(TestAsyncObservable, TestInlineExecutor)
+{
+    InlineExecutor executor;
+    AsyncObservable<int, const std::string&> obs;
+    std::vector<std::string> received;
+    auto sub = obs.subscribe(executor, [&](int i, const std::string& s) {
+        received.push_back(std::to_string(i) + s);
+    });
+
+    std::string value = "a";
+    obs.notify(1, value);
+    value = "b";
+    obs.notify(2, value);
+    EXPECT_EQ(received, (std::vector<std::string>{"1a", "2b"}));
+}
+
+TEST(TestAsyncObservable, TestThreadPoolCallsObservers)
+{
+    ThreadPool pool(4);
+    TestObservable obs;
+    std::atomic<int> total1 = 0;
+    std::atomic<int> total2 = 0;
+    std::latch done(200);
+
+    auto sub1 = obs.subscribe(pool, [&](int i) {
+        total1 += i;
+        done.count_down();
+    });
+    auto sub2 = obs.subscribe(
+        pool,
+        [&](int i) {
+            total2 += i;
+            done.count_down();
+        },
+        {.order = DispatchOrder::Unordered}
+    );
+    for (int i = 1; i <= 100; ++i) {
+        obs.notify(i);
+    }
+    done.wait();
+
+    EXPECT_EQ(total1, 5050);
+    EXPECT_EQ(total2, 5050);
+}
+
+TEST(TestAsyncObservable, TestSlowObserverDoesNotBlockNotify)
+{
+    ThreadPool worker(1);
+    TestObservable obs;
+    std::latch release(1);
+    std::atomic<int> called = 0;
+    auto sub = obs.subscribe(worker, [&](int) {
+        release.wait();
+        ++called;
+    });
+
+    for (int i = 0; i < 100; ++i) {
+        obs.notify(i);
+    }
+    EXPECT_EQ(called, 0);
+    release.count_down();
+}
+
+TEST(TestAsyncObservable, TestSequentialOrder)
+{
+    ThreadPool pool(4);
+    TestObservable obs;
+    std::vector<int> received;
+    std::atomic<bool> running = false;
+    std::atomic<bool> overlapped = false;
+    std::latch done(1000);
+
+    auto sub = obs.subscribe(pool, [&](int i) {
+        if (running.exchange(true)) {
+            overlapped = true;
+        }
+        received.push_back(i);
+        running = false;
+        done.count_down();
+    });
+    for (int i = 0; i < 1000; ++i) {
+        obs.notify(i);
+    }
+    done.wait();
+
+    EXPECT_FALSE(overlapped);
+    ASSERT_EQ(received.size(), 1000);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(received[i], i);
+    }
+}
+
+TEST(TestAsyncObservable, TestMaxPendingDropsOldest)
+{
+    std::vector<int> received;
+    {
+        ThreadPool worker(1);
+        TestObservable obs;
+        std::latch started(1);
+        std::latch release(1);
+
+        auto sub = obs.subscribe(
+            worker,
+            [&](int i) {
+                if (i == 0) {
+                    started.count_down();
+                    release.wait();
+                }
+                received.push_back(i);
+            },
+            {.max_pending = 2, .overflow = DispatchOverflow::DropOldest}
+        );
+
+        obs.notify(0);
+        started.wait();
+        for (int i = 1; i <= 5; ++i) {
+            obs.notify(i);
+        }
+        EXPECT_EQ(sub.pending(), 2);
+        EXPECT_EQ(sub.dropped(), 3);
+        release.count_down();
+        while (sub.pending() != 0) {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(received, (std::vector<int>{0, 4, 5}));
+}
+
+TEST(TestAsyncObservable, TestMaxPendingDropsNewest)
+{
+    std::vector<int> received;
+    {
+        ThreadPool worker(1);
+        TestObservable obs;
+        std::latch started(1);
+        std::latch release(1);
+
+        auto sub = obs.subscribe(
+            worker,
+            [&](int i) {
+                if (i == 0) {
+                    started.count_down();
+                    release.wait();
+                }
+                received.push_back(i);
+            },
+            {.max_pending = 2, .overflow = DispatchOverflow::DropNewest}
+        );
+
+        obs.notify(0);
+        started.wait();
+        for (int i = 1; i <= 5; ++i) {
+            obs.notify(i);
+        }
+        EXPECT_EQ(sub.dropped(), 3);
+        release.count_down();
+        while (sub.pending() != 0) {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(received, (std::vector<int>{0, 1, 2}));
+}
+
+TEST(TestAsyncObservable, TestDestructorWaitsForRunningCall)
+{
+    ThreadPool worker(1);
+    TestObservable obs;
+    std::latch started(1);
+    std::atomic<bool> finished = false;
+    std::atomic<int> called = 0;
+
+    {
+        auto sub = obs.subscribe(worker, [&](int) {
+            ++called;
+            started.count_down();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            finished = true;
+        });
+        obs.notify(1);
+        obs.notify(2);
+        started.wait();
+    }
+    EXPECT_TRUE(finished);
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestAsyncObservable, TestUnsubscribeFromCallback)
+{
+    ThreadPool worker(1);
+    TestObservable obs;
+    std::atomic<int> called = 0;
+    std::latch done(1);
+
+    ObserverHolder *holder = nullptr;
+    holder = new ObserverHolder{obs.subscribe(worker, [&](int) {
+        ++called;
+        delete holder;
+        done.count_down();
+    })};
+    obs.notify(1);
+    done.wait();
+    obs.notify(2);
+    EXPECT_EQ(obs.num_observers(), 0);
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestAsyncObservable, TestObserverOutlivesObservable)
+{
+    InlineExecutor executor;
+    auto obs = std::make_unique<TestObservable>();
+    int called = 0;
+    auto sub = obs->subscribe(executor, [&](int) { ++called; });
+    obs->notify(1);
+    obs.reset();
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestAsyncObservable, TestThrowingObserverInline)
+{
+    InlineExecutor executor;
+    TestObservable obs;
+    std::vector<int> received;
+    {
+        auto sub = obs.subscribe(executor, [&](int value) {
+            if (value == 2) {
+                throw std::runtime_error("observer failed");
+            }
+            received.push_back(value);
+        });
+        obs.notify(1);
+        EXPECT_THROW(obs.notify(2), std::runtime_error);
+        obs.notify(3);
+        EXPECT_EQ(sub.pending(), 0);
+    }
+    // The destructor returned, so the failed call was not left running
+    EXPECT_EQ(received, (std::vector<int>{1, 3}));
+    EXPECT_EQ(obs.num_observers(), 0);
+}
+
+TEST(TestAsyncObservable, TestThrowingObserverOnThreadPool)
+{
+    ThreadPool worker(1);
+    TestObservable obs;
+    std::atomic<int> called = 0;
+    std::latch done(1);
+    {
+        auto sub = obs.subscribe(worker, [&](int value) {
+            ++called;
+            if (value == 3) {
+                done.count_down();
+                return;
+            }
+            throw std::runtime_error("observer failed");
+        });
+        obs.notify(1);
+        obs.notify(2);
+        obs.notify(3);
+        done.wait();
+    }
+    EXPECT_EQ(called, 3);
+
+    std::latch ran(1);
+    worker.execute([&] { ran.count_down(); });
+    ran.wait();
+}
+
+TEST(TestAsyncObservable, TestThreadPoolRunsQueuedTasksOnDestruction)
+{
+    std::atomic<int> called = 0;
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 100; ++i) {
+            pool.execute([&] { ++called; });
+        }
+    }
+    EXPECT_EQ(called, 100);
+}
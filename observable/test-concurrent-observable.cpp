@@ -0,0 +1,136 @@
+#include "concurrent-observable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using TestObservable = ConcurrentObservable<int>;
+
+// Observers can't be moved, so are heap-allocated through this when they need
+// to be destroyed from inside a callback.
+struct ObserverHolder {
+    ConcurrentObserver<int> observer;
+};
+
+TEST(TestConcurrentObservable, TestSubscribeAndUnsubscribe)
+{
+    TestObservable obs;
+    EXPECT_EQ(obs.num_observers(), 0);
+    {
+        auto sub1 = obs.subscribe([](int) {});
+        {
+            auto sub2 = obs.subscribe([](int) {});
+            EXPECT_EQ(obs.num_observers(), 2);
+        }
+        EXPECT_EQ(obs.num_observers(), 1);
+    }
+    EXPECT_EQ(obs.num_observers(), 0);
+}
+
+TEST(TestConcurrentObservable, TestNotifyCallsObservers)
+{
+    TestObservable obs;
+    int total1 = 0;
+    int total2 = 0;
+
+    auto sub1 = obs.subscribe([&](int i) { total1 += i; });
+    obs.notify(5);
+    {
+        auto sub2 = obs.subscribe([&](int i) { total2 += i; });
+        obs.notify(-10);
+    }
+    obs.notify(20);
+
+    EXPECT_EQ(total1, 15);
+    EXPECT_EQ(total2, -10);
+}
+
+TEST(TestConcurrentObservable, TestObserverOutlivesObservable)
+{
+    auto obs = std::make_unique<TestObservable>();
+    int called = 0;
+    auto sub = obs->subscribe([&](int) { ++called; });
+    obs->notify(1);
+    obs.reset();
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestConcurrentObservable, TestUnsubscribeFromNotify)
+{
+    TestObservable obs;
+    int first_called = 0;
+    int second_called = 0;
+    std::unique_ptr<ObserverHolder> second;
+
+    auto first = obs.subscribe([&](int) {
+        ++first_called;
+        second.reset();
+    });
+    second.reset(new ObserverHolder{obs.subscribe([&](int) { ++second_called; })});
+
+    // The second observer is removed before it is reached
+    obs.notify(1);
+    EXPECT_EQ(first_called, 1);
+    EXPECT_EQ(second_called, 0);
+    EXPECT_EQ(obs.num_observers(), 1);
+}
+
+TEST(TestConcurrentObservable, TestSubscribeFromNotify)
+{
+    TestObservable obs;
+    int called = 0;
+    std::vector<std::unique_ptr<ObserverHolder>> owned;
+
+    auto sub = obs.subscribe([&](int) {
+        owned.emplace_back(new ObserverHolder{obs.subscribe([&](int) { ++called; })});
+    });
+
+    obs.notify(1);
+    EXPECT_EQ(called, 0);
+    EXPECT_EQ(obs.num_observers(), 2);
+    owned.clear();
+    EXPECT_EQ(obs.num_observers(), 1);
+}
+
+// Run with ThreadSanitizer. Notifying threads run while other threads
+// subscribe and unsubscribe.
+TEST(TestConcurrentObservable, TestStress)
+{
+    TestObservable obs;
+    std::atomic<bool> done{false};
+    std::atomic<long> total{0};
+
+    auto permanent = obs.subscribe([&](int i) { total.fetch_add(i); });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int n = 0; n < 20000; ++n) {
+                obs.notify(1);
+            }
+        });
+    }
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([&] {
+            while (!done.load()) {
+                auto counter = std::make_shared<std::atomic<int>>(0);
+                auto sub = obs.subscribe([counter](int i) { counter->fetch_add(i); });
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        threads[i].join();
+    }
+    done.store(true);
+    for (std::size_t i = 4; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    EXPECT_EQ(total.load(), 4 * 20000);
+    EXPECT_EQ(obs.num_observers(), 1);
+}
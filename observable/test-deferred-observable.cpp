@@ -0,0 +1,154 @@
+#include "deferred-observable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+TEST(TestDeferredObservable, TestNotifyDoesNotCallObservers)
+{
+    DeferredObservable<LatestValue<int>> obs;
+    int called = 0;
+    auto sub = obs.subscribe([&](const int&) { ++called; });
+    EXPECT_FALSE(obs.pending());
+    obs.notify(1);
+    obs.notify(2);
+    EXPECT_TRUE(obs.pending());
+    EXPECT_EQ(called, 0);
+}
+
+TEST(TestDeferredObservable, TestLatestValue)
+{
+    DeferredObservable<LatestValue<int>> obs;
+    std::vector<int> received1;
+    std::vector<int> received2;
+    auto sub1 = obs.subscribe([&](const int& i) { received1.push_back(i); });
+    auto sub2 = obs.subscribe([&](const int& i) { received2.push_back(i); });
+
+    for (int i = 1; i <= 100; ++i) {
+        obs.notify(i);
+    }
+    obs.flush();
+    obs.notify(-1);
+    obs.flush();
+
+    EXPECT_FALSE(obs.pending());
+    EXPECT_EQ(received1, (std::vector<int>{100, -1}));
+    EXPECT_EQ(received2, (std::vector<int>{100, -1}));
+}
+
+TEST(TestDeferredObservable, TestFlushWithoutPendingDoesNothing)
+{
+    DeferredObservable<LatestValue<int>> obs;
+    int called = 0;
+    auto sub = obs.subscribe([&](const int&) { ++called; });
+    obs.flush();
+    obs.notify(1);
+    obs.flush();
+    obs.flush();
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestDeferredObservable, TestAccumulate)
+{
+    DeferredObservable<Accumulate<int>> sum;
+    DeferredObservable<Accumulate<int, std::multiplies<int>>> product({{}, 1});
+    std::vector<int> sums;
+    std::vector<int> products;
+    auto sub1 = sum.subscribe([&](const int& i) { sums.push_back(i); });
+    auto sub2 = product.subscribe([&](const int& i) { products.push_back(i); });
+
+    for (int i = 1; i <= 4; ++i) {
+        sum.notify(i);
+        product.notify(i);
+    }
+    sum.flush();
+    product.flush();
+    sum.notify(5);
+    product.notify(5);
+    sum.flush();
+    product.flush();
+
+    EXPECT_EQ(sums, (std::vector<int>{10, 5}));
+    EXPECT_EQ(products, (std::vector<int>{24, 5}));
+}
+
+TEST(TestDeferredObservable, TestKeepAll)
+{
+    DeferredObservable<KeepAll<std::string>> obs;
+    std::vector<std::vector<std::string>> batches;
+    auto sub = obs.subscribe([&](const std::vector<std::string>& batch) {
+        batches.push_back(batch);
+    });
+
+    obs.notify("a");
+    std::string b = "b";
+    obs.notify(b);
+    obs.flush();
+    obs.notify("c");
+    obs.flush();
+
+    EXPECT_EQ(b, "b");
+    EXPECT_EQ(batches, (std::vector<std::vector<std::string>>{{"a", "b"}, {"c"}}));
+}
+
+TEST(TestDeferredObservable, TestNotifyDuringFlushGoesToNextBatch)
+{
+    DeferredObservable<KeepAll<int>> obs;
+    std::vector<std::vector<int>> batches;
+    auto sub = obs.subscribe([&](const std::vector<int>& batch) {
+        batches.push_back(batch);
+        if (batch.front() < 3) {
+            obs.notify(batch.front() + 1);
+        }
+    });
+
+    obs.notify(1);
+    obs.flush();
+    EXPECT_TRUE(obs.pending());
+    obs.flush();
+    obs.flush();
+
+    EXPECT_EQ(batches, (std::vector<std::vector<int>>{{1}, {2}, {3}}));
+}
+
+TEST(TestDeferredObservable, TestScheduler)
+{
+    std::vector<DeferredObservable<LatestValue<int>>::Task> tasks;
+    DeferredObservable<LatestValue<int>> obs;
+    obs.set_scheduler([&](auto task) { tasks.push_back(std::move(task)); });
+    std::vector<int> received;
+    auto sub = obs.subscribe([&](const int& i) { received.push_back(i); });
+
+    obs.notify(1);
+    obs.notify(2);
+    obs.notify(3);
+    EXPECT_EQ(tasks.size(), 1);
+    EXPECT_TRUE(received.empty());
+
+    for (auto& task : std::exchange(tasks, {})) {
+        task();
+    }
+    EXPECT_EQ(received, (std::vector<int>{3}));
+
+    obs.notify(4);
+    EXPECT_EQ(tasks.size(), 1);
+}
+
+TEST(TestDeferredObservable, TestScheduledFlushAfterDestruction)
+{
+    std::vector<DeferredObservable<LatestValue<int>>::Task> tasks;
+    int called = 0;
+    {
+        auto obs = std::make_unique<DeferredObservable<LatestValue<int>>>();
+        obs->set_scheduler([&](auto task) { tasks.push_back(std::move(task)); });
+        auto sub = obs->subscribe([&](const int&) { ++called; });
+        obs->notify(1);
+    }
+    ASSERT_EQ(tasks.size(), 1);
+    tasks.front()();
+    EXPECT_EQ(called, 0);
+}
@@ -0,0 +1,127 @@
+#include "forwarding-observable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct CopyCounter {
+    static inline int copies = 0;
+    static inline int conversions = 0;
+
+    std::string value;
+
+    CopyCounter(const char *value) : value(value) { ++conversions; }
+
+    CopyCounter(const CopyCounter& other) : value(other.value) { ++copies; }
+
+    CopyCounter(CopyCounter&&) = default;
+
+    CopyCounter& operator=(CopyCounter&&) = default;
+
+    static void reset()
+    {
+        copies = 0;
+        conversions = 0;
+    }
+};
+
+} // namespace
+
+TEST(TestForwardingObservable, TestViewsAreNotCopied)
+{
+    ForwardingObservable<CopyCounter, int> obs;
+    std::vector<std::string> received;
+    auto sub1 = obs.subscribe([&](const CopyCounter& c, int i) {
+        received.push_back(c.value + std::to_string(i));
+    });
+    auto sub2 = obs.subscribe([&](const CopyCounter& c, int) { received.push_back(c.value); });
+    EXPECT_EQ(obs.num_observers(), 2);
+
+    CopyCounter::reset();
+    const CopyCounter value("a");
+    obs.notify(value, 1);
+    EXPECT_EQ(CopyCounter::copies, 0);
+    EXPECT_EQ(received, (std::vector<std::string>{"a1", "a"}));
+}
+
+TEST(TestForwardingObservable, TestArgumentsMaterialisedOnce)
+{
+    ForwardingObservable<CopyCounter> obs;
+    int called = 0;
+    auto sub1 = obs.subscribe([&](const CopyCounter&) { ++called; });
+    auto sub2 = obs.subscribe([&](const CopyCounter&) { ++called; });
+    auto sub3 = obs.subscribe([&](const CopyCounter&) { ++called; });
+
+    CopyCounter::reset();
+    obs.notify("a");
+    EXPECT_EQ(called, 3);
+    EXPECT_EQ(CopyCounter::conversions, 1);
+    EXPECT_EQ(CopyCounter::copies, 0);
+}
+
+TEST(TestForwardingObservable, TestLastOwnerTakesRvalue)
+{
+    ForwardingObservable<CopyCounter> obs;
+    std::vector<std::string> viewed;
+    CopyCounter owned("");
+    auto view = obs.subscribe([&](const CopyCounter& c) { viewed.push_back(c.value); });
+    auto owner = obs.subscribe_owning([&](CopyCounter&& c) { owned = std::move(c); });
+
+    CopyCounter::reset();
+    obs.notify(CopyCounter("a"));
+    EXPECT_EQ(CopyCounter::copies, 0);
+    EXPECT_EQ(owned.value, "a");
+    EXPECT_EQ(viewed, (std::vector<std::string>{"a"}));
+
+    // Converted arguments can be moved from too
+    obs.notify("b");
+    EXPECT_EQ(CopyCounter::copies, 0);
+    EXPECT_EQ(owned.value, "b");
+}
+
+TEST(TestForwardingObservable, TestOwnerCopiesLvalue)
+{
+    ForwardingObservable<CopyCounter> obs;
+    CopyCounter owned("");
+    auto owner = obs.subscribe_owning([&](CopyCounter&& c) { owned = std::move(c); });
+
+    CopyCounter::reset();
+    CopyCounter value("a");
+    obs.notify(value);
+    EXPECT_EQ(CopyCounter::copies, 1);
+    EXPECT_EQ(owned.value, "a");
+    EXPECT_EQ(value.value, "a");
+}
+
+TEST(TestForwardingObservable, TestOwnerBeforeViewGetsCopy)
+{
+    ForwardingObservable<CopyCounter> obs;
+    std::vector<std::string> owned;
+    std::vector<std::string> viewed;
+    auto owner1 = obs.subscribe_owning([&](CopyCounter&& c) { owned.push_back(std::move(c.value)); });
+    auto view = obs.subscribe([&](const CopyCounter& c) { viewed.push_back(c.value); });
+    auto owner2 = obs.subscribe_owning([&](CopyCounter c) { owned.push_back(std::move(c.value)); });
+
+    CopyCounter::reset();
+    obs.notify(CopyCounter("a"));
+    EXPECT_EQ(CopyCounter::copies, 1);
+    EXPECT_EQ(owned, (std::vector<std::string>{"a", "a"}));
+    EXPECT_EQ(viewed, (std::vector<std::string>{"a"}));
+}
+
+TEST(TestForwardingObservable, TestUnsubscribe)
+{
+    ForwardingObservable<std::string> obs;
+    int called = 0;
+    {
+        auto sub = obs.subscribe([&](const std::string&) { ++called; });
+        obs.notify("a");
+    }
+    obs.notify("b");
+    EXPECT_EQ(called, 1);
+    EXPECT_EQ(obs.num_observers(), 0);
+}
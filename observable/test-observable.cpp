@@ -2,10 +2,18 @@
 
 #include <gtest/gtest.h>
 
+#include <functional>
+#include <memory>
 #include <vector>
 
 using TestObservable = Observable<int>;
 
+// Heap-allocated observers, for tests that destroy them in any order or from
+// inside a callback.
+struct ObserverHolder {
+    Observer<int> observer;
+};
+
 class Callback {
 private:
     int m_total = 0;
@@ -68,6 +76,17 @@ TEST(TestObservable, TestNotifyCallsObserver)
     EXPECT_EQ(c.called(), 2);
 }
 
+TEST(TestObservable, TestNullFunctionsAreNotCalled)
+{
+    TestObservable obs;
+    int called = 0;
+    auto null = obs.subscribe(static_cast<void (*)(int)>(nullptr));
+    auto empty = obs.subscribe(std::function<void(int)>());
+    auto observer = obs.subscribe([&](int) { ++called; });
+    obs.notify(0);
+    EXPECT_EQ(called, 1);
+}
+
 TEST(TestObservable, TestNotifyCallsMultipleObservers)
 {
     TestObservable obs;
@@ -130,3 +149,353 @@ TEST(TestObservable, TestRvaluesAreNotMoved)
     EXPECT_EQ(cb.called(), 2);
     EXPECT_EQ(cb.total(), 6);
 }
+
+TEST(TestObservable, TestUnsubscribeKeepsOtherObserversValid)
+{
+    TestObservable obs;
+    std::vector<int> calls(100, 0);
+
+    std::vector<std::unique_ptr<ObserverHolder>> observers;
+    for (int i = 0; i < 100; ++i) {
+        observers.emplace_back(new ObserverHolder{obs.subscribe([&calls, i](int) { ++calls[i]; })});
+    }
+
+    // Removing most observers compacts the storage; the remaining handles
+    // must still refer to the right observers.
+    for (int i = 0; i < 100; ++i) {
+        if (i % 10 != 0) {
+            observers[i].reset();
+        }
+    }
+    EXPECT_EQ(obs.num_observers(), 10);
+
+    obs.notify(1);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(calls[i], i % 10 == 0 ? 1 : 0);
+    }
+
+    observers[50].reset();
+    obs.notify(1);
+    EXPECT_EQ(calls[50], 1);
+    EXPECT_EQ(calls[60], 2);
+    EXPECT_EQ(obs.num_observers(), 9);
+}
+
+TEST(TestObservable, TestNotifiesInSubscriptionOrder)
+{
+    TestObservable obs;
+    std::vector<int> order;
+    auto sub1 = obs.subscribe([&](int) { order.push_back(1); });
+    auto sub2 = obs.subscribe([&](int) { order.push_back(2); });
+    auto sub3 = obs.subscribe([&](int) { order.push_back(3); });
+    {
+        auto sub4 = obs.subscribe([&](int) { order.push_back(4); });
+    }
+    auto sub5 = obs.subscribe([&](int) { order.push_back(5); });
+
+    obs.notify(0);
+    EXPECT_EQ(order, (std::vector<int>{1, 2, 3, 5}));
+}
+
+TEST(TestObservable, TestNotifiesInPriorityOrder)
+{
+    TestObservable obs;
+    std::vector<int> order;
+    auto sub1 = obs.subscribe([&](int) { order.push_back(1); });
+    auto sub2 = obs.subscribe([&](int) { order.push_back(2); }, 10);
+    auto sub3 = obs.subscribe([&](int) { order.push_back(3); }, -5);
+    auto sub4 = obs.subscribe([&](int) { order.push_back(4); }, 10);
+    auto sub5 = obs.subscribe([&](int) { order.push_back(5); });
+
+    obs.notify(0);
+    EXPECT_EQ(order, (std::vector<int>{2, 4, 1, 5, 3}));
+}
+
+TEST(TestObservable, TestPriorityOrderKeptAfterUnsubscribe)
+{
+    TestObservable obs;
+    std::vector<int> order;
+    std::vector<std::unique_ptr<ObserverHolder>> holders;
+    for (int i = 0; i < 8; ++i) {
+        holders.emplace_back(new ObserverHolder{
+            obs.subscribe([&order, i](int) { order.push_back(i); }, i % 2)
+        });
+    }
+    // Unsubscribe enough to compact the list, then insert between the rest
+    holders[1].reset();
+    holders[2].reset();
+    holders[4].reset();
+    holders[6].reset();
+    auto sub = obs.subscribe([&](int) { order.push_back(100); }, 1);
+
+    obs.notify(0);
+    EXPECT_EQ(order, (std::vector<int>{3, 5, 7, 100, 0}));
+    EXPECT_EQ(obs.num_observers(), 5);
+
+    holders[3].reset();
+    order.clear();
+    obs.notify(0);
+    EXPECT_EQ(order, (std::vector<int>{5, 7, 100, 0}));
+}
+
+TEST(TestObservable, TestHandlerStopsDispatch)
+{
+    TestObservable obs;
+    std::vector<int> received;
+    auto expensive = obs.subscribe([&](int i) { received.push_back(i); });
+    auto filter = obs.subscribe_handler([](int i) { return i < 0; }, 1);
+
+    EXPECT_FALSE(obs.notify(1));
+    EXPECT_TRUE(obs.notify(-1));
+    EXPECT_FALSE(obs.notify(2));
+    EXPECT_EQ(received, (std::vector<int>{1, 2}));
+}
+
+TEST(TestObservable, TestNestedNotifyHandled)
+{
+    TestObservable obs;
+    int outer_calls = 0;
+    auto first = obs.subscribe([&](int i) {
+        if (i == 0) {
+            // Handled by the nested notify only
+            EXPECT_TRUE(obs.notify(-1));
+        }
+    });
+    auto handler = obs.subscribe_handler([](int i) { return i < 0; });
+    auto last = obs.subscribe([&](int i) {
+        if (i == 0) {
+            ++outer_calls;
+        }
+    });
+
+    EXPECT_FALSE(obs.notify(0));
+    EXPECT_EQ(outer_calls, 1);
+}
+
+TEST(TestObservable, TestObserverUnsubscribesItselfDuringNotify)
+{
+    TestObservable obs;
+    std::vector<std::unique_ptr<ObserverHolder>> holders(3);
+    std::vector<int> called;
+    for (int i = 0; i < 3; ++i) {
+        holders[i].reset(new ObserverHolder{obs.subscribe([&holders, &called, i](int) {
+            called.push_back(i);
+            holders[i].reset();
+        })});
+    }
+
+    obs.notify(0);
+    EXPECT_EQ(called, (std::vector<int>{0, 1, 2}));
+    EXPECT_EQ(obs.num_observers(), 0);
+    obs.notify(0);
+    EXPECT_EQ(called.size(), 3);
+}
+
+TEST(TestObservable, TestUnsubscribedDuringNotifyIsNotCalled)
+{
+    TestObservable obs;
+    std::unique_ptr<ObserverHolder> later;
+    int later_called = 0;
+    auto first = obs.subscribe([&](int) { later.reset(); });
+    later.reset(new ObserverHolder{obs.subscribe([&](int) { ++later_called; })});
+
+    obs.notify(0);
+    EXPECT_EQ(later_called, 0);
+    EXPECT_EQ(obs.num_observers(), 1);
+}
+
+TEST(TestObservable, TestSubscribedDuringNotifyIsCalledNextTime)
+{
+    TestObservable obs;
+    std::vector<std::unique_ptr<ObserverHolder>> added;
+    std::vector<int> received;
+    auto adder = obs.subscribe([&](int i) {
+        if (i == 0) {
+            added.emplace_back(new ObserverHolder{
+                obs.subscribe([&](int j) { received.push_back(j); }, 1)
+            });
+            EXPECT_EQ(obs.num_observers(), 2);
+        }
+    });
+
+    obs.notify(0);
+    EXPECT_TRUE(received.empty());
+    obs.notify(1);
+    EXPECT_EQ(received, (std::vector<int>{1}));
+}
+
+TEST(TestObservable, TestSubscribeAndUnsubscribeDuringNotify)
+{
+    TestObservable obs;
+    int called = 0;
+    auto sub = obs.subscribe([&](int) {
+        auto temporary = obs.subscribe([&](int) { ++called; });
+    });
+
+    obs.notify(0);
+    obs.notify(0);
+    EXPECT_EQ(called, 0);
+    EXPECT_EQ(obs.num_observers(), 1);
+}
+
+TEST(TestObservable, TestNestedNotifyWithUnsubscribe)
+{
+    TestObservable obs;
+    std::vector<std::unique_ptr<ObserverHolder>> holders(4);
+    std::vector<int> called;
+    holders[0].reset(new ObserverHolder{obs.subscribe([&](int i) {
+        called.push_back(i);
+        if (i == 0) {
+            holders[2].reset();
+            obs.notify(1);
+        }
+    })});
+    for (int n = 1; n < 4; ++n) {
+        holders[n].reset(new ObserverHolder{obs.subscribe([&called, n](int i) {
+            called.push_back(10 * n + i);
+        })});
+    }
+
+    obs.notify(0);
+    EXPECT_EQ(called, (std::vector<int>{0, 1, 11, 31, 10, 30}));
+}
+
+TEST(TestObservable, TestThrowingObserverAppliesDeferredChanges)
+{
+    TestObservable obs;
+    std::unique_ptr<ObserverHolder> added;
+    int added_called = 0;
+    auto thrower = obs.subscribe([&](int i) {
+        if (i == 0) {
+            added.reset(new ObserverHolder{obs.subscribe([&](int) { ++added_called; })});
+            throw 1;
+        }
+    });
+
+    EXPECT_THROW(obs.notify(0), int);
+    obs.notify(1);
+    EXPECT_EQ(added_called, 1);
+}
+
+TEST(TestObservable, TestObserversAreMovable)
+{
+    TestObservable obs;
+    Callback callback1;
+    Callback callback2;
+
+    Observer<int> observer;
+    EXPECT_FALSE(observer.subscribed());
+    observer = obs.subscribe(std::ref(callback1));
+    EXPECT_TRUE(observer.subscribed());
+
+    Observer<int> moved(std::move(observer));
+    EXPECT_FALSE(observer.subscribed());
+    EXPECT_EQ(obs.num_observers(), 1);
+    obs.notify(1);
+    EXPECT_EQ(callback1.called(), 1);
+
+    // Assigning unsubscribes the previous subscription
+    moved = obs.subscribe(std::ref(callback2));
+    EXPECT_EQ(obs.num_observers(), 1);
+    obs.notify(2);
+    EXPECT_EQ(callback1.called(), 1);
+    EXPECT_EQ(callback2.called(), 1);
+
+    moved.reset();
+    EXPECT_EQ(obs.num_observers(), 0);
+}
+
+TEST(TestObservable, TestObserversInVector)
+{
+    TestObservable obs;
+    std::vector<Observer<int>> observers;
+    int total = 0;
+    for (int i = 0; i < 100; ++i) {
+        observers.push_back(obs.subscribe([&total, i](int x) { total += x * i; }));
+    }
+    obs.notify(1);
+    EXPECT_EQ(total, 4950);
+
+    observers.erase(observers.begin(), observers.begin() + 50);
+    EXPECT_EQ(obs.num_observers(), 50);
+    total = 0;
+    obs.notify(1);
+    EXPECT_EQ(total, 3725);
+}
+
+TEST(TestObservable, TestSwapObservers)
+{
+    TestObservable obs1;
+    TestObservable obs2;
+    int called1 = 0;
+    int called2 = 0;
+    auto observer1 = obs1.subscribe([&](int) { ++called1; });
+    auto observer2 = obs2.subscribe([&](int) { ++called2; });
+
+    swap(observer1, observer2);
+    observer1.reset();
+    obs1.notify(0);
+    obs2.notify(0);
+    EXPECT_EQ(called1, 1);
+    EXPECT_EQ(called2, 0);
+}
+
+TEST(TestObservable, TestMoveObservable)
+{
+    TestObservable obs;
+    int called = 0;
+    auto observer = obs.subscribe([&](int) { ++called; });
+
+    TestObservable moved(std::move(obs));
+    moved.notify(0);
+    EXPECT_EQ(called, 1);
+    observer.reset();
+    EXPECT_EQ(moved.num_observers(), 0);
+
+    // The moved-from Observable is empty, and still usable
+    EXPECT_EQ(obs.num_observers(), 0);
+    EXPECT_FALSE(obs.notify(0));
+    auto reused = obs.subscribe([&](int) { ++called; });
+    EXPECT_EQ(obs.num_observers(), 1);
+    obs.notify(0);
+    EXPECT_EQ(called, 2);
+    EXPECT_EQ(moved.num_observers(), 0);
+}
+
+TEST(TestObservable, TestCopiesShareObservers)
+{
+    int called = 0;
+    auto copy = std::make_unique<TestObservable>();
+    Observer<int> observer;
+    {
+        TestObservable obs;
+        observer = obs.subscribe([&](int) { ++called; });
+        *copy = obs;
+        EXPECT_EQ(copy->num_observers(), 1);
+        copy->notify(0);
+        EXPECT_EQ(called, 1);
+
+        auto second = copy->subscribe([&](int) { called += 10; });
+        obs.notify(0);
+        EXPECT_EQ(called, 12);
+    }
+
+    // Still subscribed while a copy remains
+    copy->notify(0);
+    EXPECT_EQ(called, 13);
+    copy.reset();
+    EXPECT_TRUE(observer.subscribed());
+    observer.reset();
+}
+
+TEST(TestObservable, TestObservableDestroyedDuringNotify)
+{
+    auto obs = std::make_unique<TestObservable>();
+    int later_called = 0;
+    auto destroyer = obs->subscribe([&](int) { obs.reset(); });
+    auto later = obs->subscribe([&](int) { ++later_called; });
+
+    obs->notify(0);
+    EXPECT_EQ(later_called, 0);
+    later.reset();
+}
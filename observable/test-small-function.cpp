@@ -0,0 +1,90 @@
+#include "small-function.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+
+TEST(TestSmallFunction, TestEmpty)
+{
+    SmallFunction<void()> function;
+    EXPECT_FALSE(function);
+    EXPECT_THROW(function(), std::bad_function_call);
+}
+
+TEST(TestSmallFunction, TestNullCallablesAreEmpty)
+{
+    struct Point {
+        int x;
+    };
+
+    SmallFunction<void(int)> pointer = static_cast<void (*)(int)>(nullptr);
+    EXPECT_FALSE(pointer);
+    EXPECT_THROW(pointer(0), std::bad_function_call);
+
+    SmallFunction<int(const Point&)> member = static_cast<int Point::*>(nullptr);
+    EXPECT_FALSE(member);
+
+    SmallFunction<void(int)> wrapped = std::function<void(int)>();
+    EXPECT_FALSE(wrapped);
+
+    SmallFunction<int(const Point&)> x = &Point::x;
+    EXPECT_EQ(x(Point{3}), 3);
+}
+
+TEST(TestSmallFunction, TestCallsInlineCallable)
+{
+    int total = 0;
+    SmallFunction<int(int)> function = [&total](int i) {
+        total += i;
+        return total;
+    };
+    EXPECT_TRUE(function);
+    EXPECT_EQ(function(2), 2);
+    EXPECT_EQ(function(3), 5);
+}
+
+TEST(TestSmallFunction, TestCallsHeapCallable)
+{
+    std::array<int, 32> values{};
+    values[31] = 7;
+    SmallFunction<int()> function = [values] { return values[31]; };
+    EXPECT_EQ(function(), 7);
+
+    SmallFunction<int()> moved = std::move(function);
+    EXPECT_FALSE(function);
+    EXPECT_EQ(moved(), 7);
+}
+
+TEST(TestSmallFunction, TestMoveOnlyCallable)
+{
+    auto value = std::make_unique<std::string>("hello");
+    SmallFunction<std::size_t()> function = [value = std::move(value)] { return value->size(); };
+
+    SmallFunction<std::size_t()> other;
+    other = std::move(function);
+    EXPECT_EQ(other(), 5);
+
+    other = nullptr;
+    EXPECT_FALSE(other);
+}
+
+TEST(TestSmallFunction, TestVoidIgnoresReturnValue)
+{
+    int called = 0;
+    SmallFunction<void()> function = [&called] { return ++called; };
+    function();
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestSmallFunction, TestDestroysCallable)
+{
+    auto counter = std::make_shared<int>(0);
+    {
+        SmallFunction<void()> function = [counter] {};
+        EXPECT_EQ(counter.use_count(), 2);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+}
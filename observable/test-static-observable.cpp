@@ -0,0 +1,106 @@
+#include "allocation-counter.hpp"
+#include "static-observable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+using TestObservable = StaticObservable<3, int>;
+
+TEST(TestStaticObservable, TestSubscribeAndUnsubscribe)
+{
+    TestObservable obs;
+    EXPECT_EQ(obs.num_observers(), 0);
+    EXPECT_EQ(obs.capacity(), 3);
+    {
+        auto sub1 = obs.subscribe([](int) {});
+        EXPECT_TRUE(sub1.good());
+        {
+            auto sub2 = obs.subscribe([](int) {});
+            EXPECT_EQ(obs.num_observers(), 2);
+        }
+        EXPECT_EQ(obs.num_observers(), 1);
+    }
+    EXPECT_EQ(obs.num_observers(), 0);
+}
+
+TEST(TestStaticObservable, TestSubscribeWhenFull)
+{
+    TestObservable obs;
+    int called = 0;
+    auto sub1 = obs.subscribe([&](int) { ++called; });
+    auto sub2 = obs.subscribe([&](int) { ++called; });
+    auto sub3 = obs.subscribe([&](int) { ++called; });
+    auto sub4 = obs.subscribe([&](int) { ++called; });
+    EXPECT_TRUE(sub3);
+    EXPECT_FALSE(sub4);
+    EXPECT_EQ(obs.num_observers(), 3);
+
+    obs.notify(0);
+    EXPECT_EQ(called, 3);
+}
+
+TEST(TestStaticObservable, TestNotifyCallsObservers)
+{
+    TestObservable obs;
+    int total1 = 0;
+    int total2 = 0;
+
+    auto sub1 = obs.subscribe([&](int i) { total1 += i; });
+    obs.notify(5);
+    {
+        auto sub2 = obs.subscribe([&](int i) { total2 += i; });
+        obs.notify(-10);
+    }
+    obs.notify(20);
+
+    EXPECT_EQ(total1, 15);
+    EXPECT_EQ(total2, -10);
+}
+
+TEST(TestStaticObservable, TestReusesFreedSlot)
+{
+    TestObservable obs;
+    std::vector<int> order;
+    auto sub1 = obs.subscribe([&](int) { order.push_back(1); });
+    {
+        auto sub2 = obs.subscribe([&](int) { order.push_back(2); });
+    }
+    auto sub3 = obs.subscribe([&](int) { order.push_back(3); });
+    auto sub4 = obs.subscribe([&](int) { order.push_back(4); });
+    EXPECT_TRUE(sub4);
+
+    obs.notify(0);
+    EXPECT_EQ(order, (std::vector<int>{1, 3, 4}));
+}
+
+TEST(TestStaticObservable, TestObserverOutlivesObservable)
+{
+    auto obs = std::make_unique<TestObservable>();
+    int called = 0;
+    auto sub = obs->subscribe([&](int) { ++called; });
+    obs->notify(1);
+    obs.reset();
+    EXPECT_FALSE(sub.good());
+    EXPECT_EQ(called, 1);
+}
+
+TEST(TestStaticObservable, TestDoesNotAllocate)
+{
+    std::vector<int> values;
+    values.reserve(8);
+
+    const std::size_t before = allocations;
+    {
+        StaticObservable<4, std::vector<int>&, int> obs;
+        int total = 0;
+        auto sub1 = obs.subscribe([&](std::vector<int>& v, int i) { v.push_back(i); });
+        auto sub2 = obs.subscribe([&total](std::vector<int>&, int i) { total += i; });
+        obs.notify(values, 1);
+        obs.notify(values, 2);
+        EXPECT_EQ(total, 3);
+    }
+    EXPECT_EQ(allocations, before);
+    EXPECT_EQ(values, (std::vector<int>{1, 2}));
+}